@@ -1,12 +1,29 @@
+#define _GNU_SOURCE // copy_file_range
+
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
 #include <math.h>
+#include <errno.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <linux/magic.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include <gtk/gtk.h>
 
 #define IN_RANGE(x, min, max) ((x >= min) && (x <= max))
 #define CLAMP_VALUE(x, min, max) do{if(x < min){x = min;} else if(x > max){x = max;}} while(0);
+#define IS_TEXT_ASCII(x) (IN_RANGE(x, 0x20, 0x7E) || x == '\t')
+#define MAGIC(x) x, sizeof(x) - 1 // Magic string and its length, they can contain NULs
 
 #define LINE_LENGTH 16
 #define DEFAULT_FONT "Monospace Normal 12"
@@ -19,13 +36,269 @@
 #define BOX_SPACING_PX 6
 #define TEXT_MARGIN_PX 2
 
+#define PREFETCH_CHUNK_SIZE (256 * 1024) // Must stay a multiple of the page size for madvise
+#define PREFETCH_MIN_SCREENS 4
+#define PREFETCH_LOOKAHEAD_SEC 0.5
+#define PREFETCH_MAX_BYTES (64 * 1024 * 1024)
+#define PREFETCH_THREADS 2
+
+#define STREAM_CHUNK_SIZE (4 * 1024 * 1024) // Must stay a multiple of the page size
+#define STREAM_MEMORY_LIMIT (256 * 1024 * 1024) // Past this chunks go to a temp file
+#define STREAM_MAX_LENGTH ((ulong) 16 << 30) // Address space reserved for a stream, reading stops here
+#define STREAM_DEFAULT_READ_MB 256 // Read without waiting for the view up to this, "readMB" in [Stream] of session.conf
+#define STREAM_READAHEAD_BYTES (64 * 1024 * 1024) // Past that, only read this far beyond the end of the view
+#define STREAM_POLL_INTERVAL_MS 100
+#define STREAM_UPDATE_INTERVAL_MS 100
+
+#define SCROLL_WHEEL_LINES 3
+#define SCROLL_EASE_SEC 0.05 // Time constant for easing the view towards the scroll target
+#define SCROLL_FRICTION 4.0 // Inertial velocity decays by e^-FRICTION per second
+#define SCROLL_MIN_VELOCITY 2.0 // Lines per second
+#define SCROLL_SETTLE_LINES 0.01
+
+#define CLIPBOARD_INLINE_BYTES (16 * 1024 * 1024) // Formatted on the main thread when pasted, anything bigger is exported to a file first
+
+#define CLIPBOARD_HEX 0
+#define CLIPBOARD_RAW 1
+#define CLIPBOARD_URIS 2
+#define CLIPBOARD_GNOME_FILES 3
+
+#define EXPORT_CHUNK_SIZE (4 * 1024 * 1024)
+#define EXPORT_WRITE_BUFFER (1024 * 1024)
+#define EXPORT_BASE64_BLOCK (48 * 1024)
+#define EXPORT_RECORD_LENGTH 16 // Data bytes per Intel HEX / S-Record line
+#define EXPORT_C_ARRAY_COLUMNS 12
+#define EXPORT_PROGRESS_SCALE 10000
+#define EXPORT_PROGRESS_INTERVAL_MS 100
+
+#define EXPORT_RAW 0
+#define EXPORT_C_ARRAY 1
+#define EXPORT_BASE64 2
+#define EXPORT_INTEL_HEX 3
+#define EXPORT_SREC 4
+#define EXPORT_HEX 5 // Same layout as the hex view
+#define EXPORT_HEX_BLOCK (64 * LINE_LENGTH) // Bytes formatted per write buffer reservation
+
+#define SCAN_CHUNK_SIZE (16 * 1024 * 1024) // Must stay even so UTF-16 units don't straddle chunks
+
+#define STRINGS_DEFAULT_MIN_LENGTH 4
+#define STRINGS_DISPLAY_LENGTH 256 // Bytes of decoded text drawn per row
+#define STRINGS_NO_SELECTION G_MAXUINT
+
+#define STRINGS_ASCII 0
+#define STRINGS_UTF8 1
+#define STRINGS_UTF16LE 2
+#define STRINGS_UTF16BE 3
+
+#define SIGNATURE_MARKER_COLOR {0.96, 0.47, 0.0, 1.0}
+
+#define DUPLICATE_DEFAULT_BLOCK_SIZE 4096 // Must stay a power of two
+#define DUPLICATE_DEFAULT_INDEX_MB 64
+#define DUPLICATE_EMPTY_SLOT G_MAXUINT
+#define DUPLICATE_MAX_CHAIN 256 // Copies of one block kept in the index, more are only counted
+#define DUPLICATE_HIGHLIGHT_COLOR {0.45, 0.62, 0.81, 0.35}
+
+#define DUPLICATE_FIXED 0
+#define DUPLICATE_CONTENT 1
+
+#define SESSION_MAX_FILES 10
+#define SESSION_MAX_HINTS 32 // Ranges of a file to read ahead when it's reopened
+
+#define PREFETCH_CHUNK_QUEUED 0x1
+#define PREFETCH_CHUNK_READY  0x2
+#define PREFETCH_CHUNK_SEEN   0x4
+
 typedef uint8_t byte;
 
+struct _Color {
+    union {
+        uint RGBA;
+        struct {
+            byte alpha;
+            byte blue;
+            byte green;
+            byte red;
+        };
+    };
+};
+typedef struct _Color Color;
+
+struct _PrefetchTask {
+    ulong chunk;
+    int direction;
+};
+typedef struct _PrefetchTask PrefetchTask;
+
+struct _ClipboardRange {
+    ulong start;
+    ulong length;
+    int format;
+    char *path; // Export the data is served from, NULL while it comes straight from the file buffer
+};
+typedef struct _ClipboardRange ClipboardRange;
+
+struct _ExportJob {
+    GThread *thread;
+    char *path;
+    char *tempPath; // Written here and renamed over path only once everything made it
+    int format;
+    ulong start;
+    ulong length;
+    ulong fileLength; // Taken when the export starts, the worker never reads the live length
+    int inFd;
+    int outFd;
+
+    char *writeBuffer;
+    ulong writeUsed;
+
+    // Encoder state carried between chunks
+    gint base64State;
+    gint base64Save;
+    uint ihexUpper;
+
+    gint progress; // Out of EXPORT_PROGRESS_SCALE
+    gint cancelled;
+    int error; // errno of the first failure
+    bool completed;
+    ClipboardRange *clipboardRange; // Claimed once the export is in place, NULL for a normal export
+    gint finished; // Set by the worker right before it queues exportFinished
+};
+typedef struct _ExportJob ExportJob;
+
+struct _StreamSource {
+    GThread *thread;
+    int fd;
+    int spillFd; // Unlinked temp file behind the chunks past STREAM_MEMORY_LIMIT
+    char *spillDir;
+    byte *base; // Chunks are mapped here back to back as data arrives
+    ulong mappedLength; // Only touched by the reader
+
+    gsize length; // Bytes readable from base, published by the reader
+    gsize wanted; // The reader waits once it has this much, raised by the view
+    gint paused;
+    gint cancelled;
+    gint finished;
+    int error; // errno that stopped the reader
+};
+typedef struct _StreamSource StreamSource;
+
+struct _ScanChunk {
+    ulong start;
+    ulong end;
+    GArray *results; // Only touched by the worker that owns the chunk
+    bool scanned; // Under the job's mergeLock
+};
+typedef struct _ScanChunk ScanChunk;
+
+typedef struct _ScanJob ScanJob;
+struct _ScanJob {
+    GThreadPool *pool;
+    ScanChunk *chunks;
+    ulong numChunks;
+    guint resultSize;
+    ulong fileLength; // Taken when the job starts, a growing stream must not change it under the workers
+
+    void (*scanChunk)(ScanJob *job, ScanChunk *chunk); // Runs on the pool
+    void (*mergeChunk)(ScanJob *job, ScanChunk *chunk); // Optional, runs on the pool one chunk at a time in file order
+    void (*finished)(ScanJob *job, GArray *results); // Runs on the main loop with every chunk's results in file order
+    gpointer data; // Freed with the job
+
+    GMutex mergeLock;
+    ulong nextMerge;
+
+    gint chunksDone;
+    gint cancelled;
+    gint finishQueued;
+};
+
+struct _StringHit {
+    ulong offset;
+    uint length; // In bytes
+    uint encoding;
+};
+typedef struct _StringHit StringHit;
+
+struct _StringsOptions {
+    uint minLength; // In characters
+    bool ascii;
+    bool utf8;
+    bool utf16le;
+    bool utf16be;
+};
+typedef struct _StringsOptions StringsOptions;
+
+struct _Signature {
+    const char *name;
+    const char *magic;
+    uint magicLength;
+    uint magicOffset; // Where the magic sits in the header, hits are reported at the start of the header
+    uint headerLength; // Bytes the validator may read
+    bool (*validate)(const byte *data, ulong available);
+};
+typedef struct _Signature Signature;
+
+struct _SignatureMatcher {
+    uint *next; // 256 transitions per state, failure links already folded in
+    int *output; // Signature whose magic ends at this state, -1 for none
+    uint *outputLink; // Closest state along the failure chain with an output, 0 for none
+    int *sameMagic; // Next signature with an identical magic, -1 for none
+    uint numStates;
+    uint maxLength;
+};
+typedef struct _SignatureMatcher SignatureMatcher;
+
+struct _SignatureHit {
+    ulong offset;
+    uint signature;
+};
+typedef struct _SignatureHit SignatureHit;
+
+struct _BlockHash {
+    guint64 hash;
+    ulong offset;
+    uint length;
+    uint next; // Next entry with the same hash, DUPLICATE_EMPTY_SLOT ends the chain
+    uint copies; // Blocks seen with this hash so far, stored or not. Only the head of a chain is current.
+};
+typedef struct _BlockHash BlockHash;
+
+struct _DuplicateIndex {
+    BlockHash *entries;
+    uint numEntries;
+    uint capacity;
+    uint *slots; // Open addressing on the hash, each slot holds the newest entry of its chain
+    uint slotMask;
+    guint64 sampleMask; // Only hashes with none of these bits set are kept, grows whenever the index fills up
+    ulong blocksSeen;
+};
+typedef struct _DuplicateIndex DuplicateIndex;
+
+struct _DuplicateOptions {
+    int mode;
+    uint blockSize;
+    DuplicateIndex *index;
+};
+typedef struct _DuplicateOptions DuplicateOptions;
+
 struct _ProgramState {
     GtkWidget *window;
 
     GtkWidget *closeMenuI;
+    GtkWidget *recentMenuI;
+    GtkWidget *recentMenu;
     GtkWidget *gotoMenuI;
+    GtkWidget *exportMenuI;
+    GtkWidget *copyHexMenuI;
+    GtkWidget *copyRawMenuI;
+    GtkWidget *selectAllMenuI;
+    GtkWidget *stringsMenuI;
+    GtkWidget *signaturesMenuI;
+    GtkWidget *nextSignatureMenuI;
+    GtkWidget *previousSignatureMenuI;
+    GtkWidget *duplicatesMenuI;
+    GtkWidget *showDuplicatesMenuI;
+    GtkWidget *nextDuplicateMenuI;
+    GtkWidget *previousDuplicateMenuI;
 
     GtkWidget *viewWidgetsBox;
     GtkWidget *offsetBox;
@@ -35,9 +308,85 @@ struct _ProgramState {
 
     GtkAdjustment *scrollAdj;
 
+    GKeyFile *session; // Recent files, where they were left and what was read, saved on close
+    gint64 startupTime;
+    bool startupBenchmark; // Quit after the first frame and don't touch the session
+    bool firstFrameShown;
+    bool sessionDirty; // Written once startup is over, not on the way to the first frame
+    guint sessionWriteId;
+
+    // Smooth scrolling. Input only moves the target, the tick callback moves the adjustment once per frame.
+    guint scrollTickId;
+    gint64 scrollLastFrame;
+    double scrollTarget;
+    double scrollVelocity; // Lines per second of inertia left after a touchpad fling
+    double scrollTrackVelocity; // Lines per second of the current touchpad gesture
+    guint32 scrollLastEventTime;
+    bool scrollFromTick;
+
+    // Selection is inclusive on both ends, the anchor is where the drag or shift-click started
+    bool hasSelection;
+    bool selecting;
+    ulong selectionAnchor;
+    ulong selectionCursor;
+
+    ClipboardRange *clipboardRange; // Non NULL while we own the clipboard
+
+    ExportJob *exportJob;
+    GtkWidget *exportDialog;
+    GtkWidget *exportProgressBar;
+    guint exportTimerId;
+
+    StreamSource *stream; // Non NULL when the open file is a pipe or device still being read
+    bool fileFromStdin; // Even when stdin is a regular file, its path means something else next time
+    guint streamTimerId;
+    bool streamPaused;
+
+    GtkWidget *stringsWindow;
+    GtkWidget *stringsMinLength;
+    GtkWidget *stringsAsciiCheck;
+    GtkWidget *stringsUtf8Check;
+    GtkWidget *stringsUtf16leCheck;
+    GtkWidget *stringsUtf16beCheck;
+    GtkWidget *stringsScanButton;
+    GtkWidget *stringsStatus;
+    GtkWidget *stringsList;
+    GtkWidget *stringsScrollBar;
+    GtkAdjustment *stringsAdj;
+    ScanJob *stringsJob;
+    guint stringsTimerId;
+    GArray *stringsResults; // StringHit sorted by offset
+    uint stringsSelectedRow;
+
+    SignatureMatcher *signatureMatcher; // Built on first use and kept
+    ScanJob *signatureJob;
+    GtkWidget *signatureDialog;
+    GtkWidget *signatureProgressBar;
+    guint signatureTimerId;
+    GArray *signatureHits; // SignatureHit sorted by offset
+
+    guint64 gearTable[256];
+    bool gearTableValid;
+    ScanJob *duplicateJob;
+    GtkWidget *duplicateDialog;
+    GtkWidget *duplicateProgressBar;
+    guint duplicateTimerId;
+    DuplicateIndex *duplicateIndex;
+    int duplicateMode; // Settings the index was built with
+    uint duplicateBlockSize;
+    ulong duplicateFileLength; // A stream may have grown since, the cuts past this were never made
+    GArray *duplicateOffsets; // Every copy of the block being shown, sorted
+    ulong duplicateLength;
+
     PangoFontDescription *fontDesc;
+
+    // Foreground color per byte value, rebuilt when the theme changes
+    Color byteColors[256];
+    Color byteColorsBase;
+    bool byteColorsValid;
     uint fontWidth;
     uint fontHeight;
+    bool fontMetricsValid; // Measuring is put off until the view is realized unless the cache has them
 
     uint widgetHeight;
     uint numLines;
@@ -52,6 +401,24 @@ struct _ProgramState {
     byte *fileBuffer;
     ulong fileLength;
     uint  fileNumLines;
+    bool  fileMapped;
+
+    // Readahead for the scroll path, only used when the file is mmapped
+    GThreadPool *prefetchPool;
+    GMutex prefetchLock; // Guards the chunk state, view position and counters below
+    byte *prefetchChunkState;
+    ulong prefetchNumChunks;
+    ulong prefetchViewFirst;
+    ulong prefetchViewLast;
+    int prefetchDirection;
+    double prefetchVelocity; // Lines per second, smoothed
+    double prefetchLastValue;
+    gint64 prefetchLastTime;
+    ulong prefetchIssued;
+    ulong prefetchCompleted;
+    ulong prefetchDropped;
+    ulong prefetchHits;
+    ulong prefetchMisses;
 };
 typedef struct _ProgramState ProgramState;
 
@@ -63,16 +430,182 @@ void shutdownAndCleanup();
 void closeCurrentFile(bool performUpdates);
 
 void openFile(char *filename);
+bool streamMapChunk(StreamSource *stream);
+gpointer streamReader(gpointer data);
+gboolean streamUpdate(gpointer data);
+bool startStream(int fd);
+void stopStream();
+void streamRequestView(double value);
+void startPrefetch();
+void stopPrefetch();
+void prefetchWorker(gpointer data, gpointer userData);
+void updatePrefetch(double value);
 void openMenuAction(GtkMenuItem *menuItem);
 void gotoActivateCallback(GtkWidget *widget, gpointer data);
 void openGotoDialog();
 void gotoMenuAction(GtkWidget *widget);
 void fontMenuAction(GtkMenuItem *menuItem);
 
+void formatHex(char *dest, const byte *src, ulong count, uint lineLength);
+
+bool getSelection(ulong *start, ulong *end);
+void clearSelection();
+ulong offsetAtPoint(GtkWidget *widget, double x, double y);
+bool onButtonPress(GtkWidget *widget, GdkEventButton *event);
+bool onMotion(GtkWidget *widget, GdkEventMotion *event);
+bool onButtonRelease(GtkWidget *widget, GdkEventButton *event);
+void clipboardGet(GtkClipboard *clipboard, GtkSelectionData *selectionData, guint info, gpointer data);
+void clipboardGetFile(GtkSelectionData *selectionData, guint info, ClipboardRange *range);
+void freeClipboardRange(ClipboardRange *range);
+void clipboardClear(GtkClipboard *clipboard, gpointer data);
+void claimClipboard(ClipboardRange *range);
+void copySelection(int format);
+void copyHexMenuAction(GtkMenuItem *menuItem);
+void copyRawMenuAction(GtkMenuItem *menuItem);
+void selectAllMenuAction(GtkMenuItem *menuItem);
+
+void exportWrite(ExportJob *job, const char *data, ulong length);
+void exportFlush(ExportJob *job);
+char *exportReserve(ExportJob *job, ulong length);
+void exportPutString(ExportJob *job, const char *str);
+void putHexByte(char *dest, byte value);
+void writeIhexRecord(ExportJob *job, byte type, uint address, const byte *data, uint count);
+void writeSrecRecord(ExportJob *job, char type, uint address, uint addressBytes, const byte *data, uint count);
+void exportEncodeChunk(ExportJob *job, const byte *src, ulong position, ulong count);
+bool exportCopyRange(ExportJob *job);
+gpointer exportWorker(gpointer data);
+gboolean exportUpdateProgress(gpointer data);
+void exportDialogResponse(GtkWidget *dialog, gint response, gpointer data);
+void finishExport(bool quiet);
+gboolean exportFinished(gpointer data);
+void stopExport();
+void startExport(char *path, int format, ulong start, ulong length, ClipboardRange *clipboardRange);
+void exportMenuAction(GtkMenuItem *menuItem);
+
+void scanJobWorker(gpointer data, gpointer userData);
+gboolean scanJobFinished(gpointer data);
+void freeScanJob(ScanJob *job);
+ScanJob *startScanJob(ulong chunkSize, guint resultSize, void (*scanChunk)(ScanJob *, ScanChunk *), void (*mergeChunk)(ScanJob *, ScanChunk *), void (*finished)(ScanJob *, GArray *), gpointer data);
+void cancelScanJob(ScanJob *job);
+double scanJobProgress(ScanJob *job);
+
+ulong skipNonText(const byte *data, ulong length);
+uint utf8TextLength(const byte *data, ulong available);
+uint textLength8(const byte *data, ulong available, bool utf8);
+bool utf16IsText(const byte *data, bool bigEndian);
+void addStringHit(GArray *hits, ulong offset, ulong length, uint encoding);
+void scanStrings8(ScanChunk *chunk, StringsOptions *options, ulong fileEnd);
+void scanStrings16(ScanChunk *chunk, StringsOptions *options, bool bigEndian, ulong fileEnd);
+gint compareStringHits(gconstpointer a, gconstpointer b);
+void scanStringsChunk(ScanJob *job, ScanChunk *chunk);
+void stringsScanFinished(ScanJob *job, GArray *results);
+gboolean stringsUpdateProgress(gpointer data);
+void setStringsResults(GArray *results);
+void stopStringsScan();
+void stringsScanAction(GtkWidget *button);
+void jumpToRange(ulong offset, ulong length);
+uint formatStringHit(StringHit *hit, char *dest, uint destLength);
+gboolean renderStringsList(GtkWidget *widget, cairo_t *cr);
+void onStringsListSize(GtkWidget *widget, GdkRectangle *newRectangle);
+bool onStringsListPress(GtkWidget *widget, GdkEventButton *event);
+bool onStringsListScroll(GtkWidget *widget, GdkEvent *event);
+void onStringsAdjValueChanged(GtkAdjustment *adj);
+void buildStringsWindow();
+void stringsMenuAction(GtkMenuItem *menuItem);
+
+uint readLE16(const byte *data);
+uint readLE32(const byte *data);
+uint readBE16(const byte *data);
+uint readBE32(const byte *data);
+uint computeCrc32(const byte *data, ulong length);
+bool validateZip(const byte *data, ulong available);
+bool validateGzip(const byte *data, ulong available);
+bool validateBzip2(const byte *data, ulong available);
+bool validateXz(const byte *data, ulong available);
+bool validate7z(const byte *data, ulong available);
+bool validateZstd(const byte *data, ulong available);
+bool validateLz4(const byte *data, ulong available);
+bool validateTar(const byte *data, ulong available);
+bool validateCpio(const byte *data, ulong available);
+bool validateCab(const byte *data, ulong available);
+bool validatePng(const byte *data, ulong available);
+bool validateJpeg(const byte *data, ulong available);
+bool validateGif(const byte *data, ulong available);
+bool validateBmp(const byte *data, ulong available);
+bool validateTiff(const byte *data, ulong available);
+bool validateRiff(const byte *data, ulong available);
+bool validateElf(const byte *data, ulong available);
+bool validatePe(const byte *data, ulong available);
+bool validateMachO(const byte *data, ulong available);
+bool validateJavaClass(const byte *data, ulong available);
+bool validateDex(const byte *data, ulong available);
+bool validateSquashfs(const byte *data, ulong available);
+bool validateCramfs(const byte *data, ulong available);
+bool validateExt(const byte *data, ulong available);
+bool validateIso9660(const byte *data, ulong available);
+bool validateFat(const byte *data, ulong available);
+bool validateUbi(const byte *data, ulong available);
+bool validateUImage(const byte *data, ulong available);
+bool validateDtb(const byte *data, ulong available);
+bool validateLuks(const byte *data, ulong available);
+bool validatePdf(const byte *data, ulong available);
+bool validateSqlite(const byte *data, ulong available);
+bool validateOle(const byte *data, ulong available);
+bool validateMp4(const byte *data, ulong available);
+bool validateOgg(const byte *data, ulong available);
+bool validateFlac(const byte *data, ulong available);
+bool validateId3(const byte *data, ulong available);
+bool validatePem(const byte *data, ulong available);
+void buildSignatureMatcher();
+void addSignatureHit(ScanJob *job, ScanChunk *chunk, ulong magicStart, int signature);
+gint compareSignatureHits(gconstpointer a, gconstpointer b);
+void scanSignaturesChunk(ScanJob *job, ScanChunk *chunk);
+void signatureScanFinished(ScanJob *job, GArray *results);
+gboolean signatureUpdateProgress(gpointer data);
+void signatureDialogResponse(GtkWidget *dialog, gint response, gpointer data);
+void stopSignatureScan();
+void signaturesMenuAction(GtkMenuItem *menuItem);
+uint findSignatureHit(ulong offset);
+void jumpToSignature(int direction);
+void nextSignatureMenuAction(GtkMenuItem *menuItem);
+void previousSignatureMenuAction(GtkMenuItem *menuItem);
+bool onQuerySignatureTooltip(GtkWidget *widget, gint x, gint y, gboolean keyboardMode, GtkTooltip *tooltip);
+void renderSignatureMarkers(cairo_t *cr, ulong lineOffset, int y, uint cellChars, uint gapChars);
+
+void buildGearTable();
+guint64 hashBlock(const byte *data, ulong length);
+ulong nextBlockLength(const byte *data, ulong available, int mode, uint blockSize);
+DuplicateIndex *newDuplicateIndex(ulong bytes);
+void freeDuplicateIndex(DuplicateIndex *index);
+void duplicateIndexInsertSlot(DuplicateIndex *index, uint entry);
+uint duplicateIndexFind(DuplicateIndex *index, guint64 hash);
+void duplicateIndexSample(DuplicateIndex *index);
+void duplicateIndexAdd(DuplicateIndex *index, BlockHash *block);
+void scanDuplicatesChunk(ScanJob *job, ScanChunk *chunk);
+void mergeDuplicatesChunk(ScanJob *job, ScanChunk *chunk);
+void duplicateScanFinished(ScanJob *job, GArray *results);
+gboolean duplicateUpdateProgress(gpointer data);
+void duplicateDialogResponse(GtkWidget *dialog, gint response, gpointer data);
+void stopDuplicateScan();
+void clearDuplicates();
+void duplicatesMenuAction(GtkMenuItem *menuItem);
+void findBlockAt(ulong offset, ulong *start, ulong *length);
+gint compareOffsets(gconstpointer a, gconstpointer b);
+void showDuplicatesMenuAction(GtkMenuItem *menuItem);
+uint findDuplicateOccurrence(ulong offset);
+void jumpToDuplicate(int direction);
+void nextDuplicateMenuAction(GtkMenuItem *menuItem);
+void previousDuplicateMenuAction(GtkMenuItem *menuItem);
+void renderDuplicateBlocks(cairo_t *cr, ulong lineOffset, int y, uint cellChars, uint gapChars);
+
+double clampScrollValue(double value);
+void scrollByLines(double lines);
+gboolean onScrollTick(GtkWidget *widget, GdkFrameClock *frameClock, gpointer data);
+
 bool onKeyPress(GtkWidget *widget, GdkEventKey *event);
 void onUpdateSize(GtkWidget *widget, GdkRectangle *newRectangle);
 void onAdjValueChanged(GtkAdjustment *adj);
-void onScrollEvent(GtkWidget *widget, GdkEvent *event);
+bool onScrollEvent(GtkWidget *widget, GdkEvent *event);
 
 void updateTitle();
 uint getFontWidth(GtkWidget *widget, PangoFontDescription *fontDesc);
@@ -80,8 +613,34 @@ void updateFont(PangoFontDescription *newDesc);
 void updateSizeRequests();
 void updateSizeRequests();
 
+char *fontMetricsKey(PangoFontDescription *fontDesc);
+bool loadCachedFontMetrics(PangoFontDescription *fontDesc);
+void storeFontMetrics(PangoFontDescription *fontDesc);
+void ensureFontMetrics();
+void onViewRealize(GtkWidget *widget);
+char *sessionGroup(const char *path);
+void loadSession();
+void writeSession();
+gboolean sessionWriteIdle(gpointer data);
+void queueSessionWrite();
+void rememberRecentFile(const char *path);
+void rememberFileSession();
+void restoreFileSession();
+void recentMenuAction(GtkMenuItem *menuItem);
+void rebuildRecentMenu();
+void onFirstFrame(GdkFrameClock *frameClock, gpointer data);
+
+double adjustRange(double value, double oldmin, double oldmax, double newmin, double newmax);
+double denormalizeColor(double color);
+Color gdkToColor(GdkRGBA gdkColor);
+Color parseColor(const char *str, Color fallback);
+void buildByteColors(GtkWidget *widget);
+void onStyleUpdated(GtkWidget *widget);
+void applyByteColors(PangoLayout *pangoLayout, ulong offset, uint cellChars, uint textChars);
+
 void fillHexBuffer(ulong offset);
 void fillAsciiBuffer(ulong offset);
+void renderSelection(cairo_t *cr, GtkStyleContext *styleContext, ulong lineOffset, int y, uint cellChars, uint gapChars);
 gboolean renderOffsetBox(GtkWidget *widget, cairo_t *cr);
 gboolean renderHexBox(GtkWidget *widget, cairo_t *cr);
 gboolean renderAsciiBox(GtkWidget *widget, cairo_t *cr);
@@ -103,11 +662,25 @@ int jceil(double value) {
 void shutdownAndCleanup() {
     // TODO(Adin): Close files and do cleanup here
     closeCurrentFile(false);
+    writeSession();
 
     gtk_main_quit();
 }
 
 void closeCurrentFile(bool performUpdates) {
+    // Before prefetch goes away, it knows what was looked at
+    if(state.file) {
+        rememberFileSession();
+    }
+
+    // Workers read from the mapping so they have to be gone before it is unmapped
+    stopExport();
+    stopStringsScan();
+    stopSignatureScan();
+    stopDuplicateScan();
+    stopPrefetch();
+    stopStream();
+
     if(state.file != NULL) {
         fclose(state.file);
         state.file = NULL;
@@ -119,12 +692,49 @@ void closeCurrentFile(bool performUpdates) {
     }
 
     if(state.fileBuffer != NULL) {
-        free(state.fileBuffer);
+        if(state.fileMapped) {
+            munmap(state.fileBuffer, state.fileLength);
+        }
+        else {
+            free(state.fileBuffer);
+        }
         state.fileBuffer = NULL;
     }
 
     state.fileLength = 0;
+    state.fileMapped = FALSE;
+    state.fileFromStdin = FALSE;
+
+    if(state.scrollTickId) {
+        gtk_widget_remove_tick_callback(state.viewWidgetsBox, state.scrollTickId);
+        state.scrollTickId = 0;
+    }
+    state.scrollVelocity = 0;
+    state.scrollTrackVelocity = 0;
+
+    // The clipboard only references the file, it can't be served once it's gone. Exported copies stand on their own.
+    if(state.clipboardRange && !state.clipboardRange->path && state.window) {
+        gtk_clipboard_clear(gtk_widget_get_clipboard(state.window, GDK_SELECTION_CLIPBOARD));
+    }
+    clearSelection();
     state.fileNumLines = 0;
+
+    // Hits are only offsets into this file
+    setStringsResults(NULL);
+    if(state.stringsStatus) {
+        gtk_label_set_text(GTK_LABEL(state.stringsStatus), "");
+    }
+
+    if(state.signatureHits) {
+        g_array_free(state.signatureHits, TRUE);
+        state.signatureHits = NULL;
+    }
+
+    clearDuplicates();
+    if(state.duplicateIndex) {
+        freeDuplicateIndex(state.duplicateIndex);
+        state.duplicateIndex = NULL;
+    }
     
     if(performUpdates) {
         updateTitle();
@@ -140,165 +750,3717 @@ void closeCurrentFile(bool performUpdates) {
 }
 
 void openFile(char *filename) {
+    struct stat fileStat = {0};
+
     closeCurrentFile(false);
 
-    state.fileFullName = malloc(strlen(filename) + 1);
-    memcpy(state.fileFullName, filename, strlen(filename) + 1); // + 1 to copy the implicit null terminator
+    // Absolute so the title and the session work the same for paths from the command line
+    if(strcmp(filename, "-") == 0) {
+        // Our own descriptor so closing the file doesn't close stdin
+        int fd = dup(STDIN_FILENO);
+
+        state.fileFullName = strdup("/dev/stdin");
+        state.fileFromStdin = TRUE;
+        state.file = fd >= 0 ? fdopen(fd, "r") : NULL;
+    }
+    else {
+        state.fileFullName = realpath(filename, NULL);
+        if(state.fileFullName) {
+            state.file = fopen(state.fileFullName, "r");
+        }
+    }
+
+    // fopen happily opens a directory for reading, it would only fail once the stream reader gets to it
+    if(state.file && fstat(fileno(state.file), &fileStat) == 0 && S_ISDIR(fileStat.st_mode)) {
+        fclose(state.file);
+        state.file = NULL;
+        errno = EISDIR;
+    }
+
+    if(!state.file) {
+        GtkWidget *errorDialog = gtk_message_dialog_new(GTK_WINDOW(state.window), GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT, GTK_MESSAGE_ERROR, GTK_BUTTONS_CLOSE, "Couldn't open \"%s\": %s", filename, strerror(errno));
+        gtk_dialog_run(GTK_DIALOG(errorDialog));
+        gtk_widget_destroy(errorDialog);
+
+        free(state.fileFullName);
+        state.fileFullName = NULL;
+        toggleMenuSensitivity();
+        return;
+    }
+
+    // Pipes, sockets and character devices can't be sized or mapped, they're read as the data arrives
+    if(fstat(fileno(state.file), &fileStat) == 0 && (S_ISREG(fileStat.st_mode) || S_ISBLK(fileStat.st_mode))) {
+        fseek(state.file, 0, SEEK_END);
+        state.fileLength = ftell(state.file);
+        fseek(state.file, 0, SEEK_SET);
+
+        // Map the file so pages only get read when they're needed and the prefetcher can
+        // pull them in ahead of the view. Fall back to reading it all if that fails.
+        if(state.fileLength > 0) {
+            void *mapping = mmap(NULL, state.fileLength, PROT_READ, MAP_PRIVATE, fileno(state.file), 0);
+
+            if(mapping != MAP_FAILED) {
+                state.fileBuffer = mapping;
+                state.fileMapped = TRUE;
+            }
+        }
+
+        if(!state.fileMapped) {
+            state.fileBuffer = malloc(state.fileLength + 1);
+            memset(state.fileBuffer, 0, state.fileLength + 1);
+            fread(state.fileBuffer, 1, state.fileLength, state.file);
+        }
+
+        state.fileNumLines = jceil((float) state.fileLength / (float) LINE_LENGTH);
+
+        startPrefetch();
+    }
+    else if(!startStream(fileno(state.file))) {
+        GtkWidget *errorDialog = gtk_message_dialog_new(GTK_WINDOW(state.window), GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT, GTK_MESSAGE_ERROR, GTK_BUTTONS_CLOSE, "Couldn't read \"%s\": %s", filename, strerror(errno));
+        gtk_dialog_run(GTK_DIALOG(errorDialog));
+        gtk_widget_destroy(errorDialog);
+
+        closeCurrentFile(TRUE);
+        return;
+    }
+
+    toggleMenuSensitivity();
+    updateSizeRequests();
+
+    // The adjustment has to know the new length before the old position can be restored
+    onUpdateSize(state.hexBox, NULL);
+
+    // Neither a stream nor stdin can be opened again from a path
+    if(!state.stream && !state.fileFromStdin) {
+        restoreFileSession();
+
+        rememberRecentFile(state.fileFullName);
+        rebuildRecentMenu();
+        queueSessionWrite();
+    }
+
+    if(state.viewWidgetsBox) {
+        gtk_widget_queue_draw(state.viewWidgetsBox);
+    }
+}
+
+bool streamMapChunk(StreamSource *stream) {
+    byte *chunk = stream->base + stream->mappedLength;
+    void *mapping = MAP_FAILED;
+
+    if(stream->mappedLength + STREAM_CHUNK_SIZE > STREAM_MAX_LENGTH) {
+        stream->error = EFBIG;
+        return FALSE;
+    }
+
+    if(stream->mappedLength < STREAM_MEMORY_LIMIT) {
+        mapping = mmap(chunk, STREAM_CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+    }
+    else {
+        ulong spillOffset = stream->mappedLength - STREAM_MEMORY_LIMIT;
+
+        if(stream->spillFd < 0) {
+            // Never linked anywhere so nothing is left behind whatever way we exit
+            stream->spillFd = open(stream->spillDir, O_TMPFILE | O_RDWR, 0600);
+
+            if(stream->spillFd < 0) {
+                char *path = g_build_filename(stream->spillDir, "stream-XXXXXX", NULL);
+
+                stream->spillFd = g_mkstemp(path);
+                if(stream->spillFd >= 0) {
+                    unlink(path);
+                }
+                g_free(path);
+            }
+
+            if(stream->spillFd < 0) {
+                stream->error = errno;
+                return FALSE;
+            }
+        }
+
+        // Sized for the whole chunk so the part not read yet is zeros instead of SIGBUS
+        if(ftruncate(stream->spillFd, spillOffset + STREAM_CHUNK_SIZE) != 0) {
+            stream->error = errno;
+            return FALSE;
+        }
+
+        // Shared so the kernel can write the pages back and drop them instead of keeping them in memory
+        mapping = mmap(chunk, STREAM_CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, stream->spillFd, spillOffset);
+    }
+
+    if(mapping == MAP_FAILED) {
+        stream->error = errno;
+        return FALSE;
+    }
+
+    stream->mappedLength += STREAM_CHUNK_SIZE;
+
+    return TRUE;
+}
+
+gpointer streamReader(gpointer data) {
+    StreamSource *stream = data;
+    struct pollfd pollFd = {.fd = stream->fd, .events = POLLIN};
+    ulong length = 0;
+
+    while(!g_atomic_int_get(&stream->cancelled)) {
+        // Endless sources like /dev/zero would otherwise fill the spill file as fast as they can
+        if(length >= g_atomic_pointer_get(&stream->wanted)) {
+            g_atomic_int_set(&stream->paused, 1);
+            g_usleep(STREAM_POLL_INTERVAL_MS * 1000);
+            continue;
+        }
+        g_atomic_int_set(&stream->paused, 0);
+
+        if(length == stream->mappedLength && !streamMapChunk(stream)) {
+            break;
+        }
+
+        // Waits in short slices so closing the file doesn't hang on a quiet producer
+        int ready = poll(&pollFd, 1, STREAM_POLL_INTERVAL_MS);
+        if(ready == 0 || (ready < 0 && errno == EINTR)) {
+            continue;
+        }
+
+        // Straight into the chunk, the view only looks below the published length so nothing has to be locked
+        ssize_t result = ready < 0 ? -1 : read(stream->fd, stream->base + length, stream->mappedLength - length);
+
+        if(result < 0) {
+            if(errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+
+            stream->error = errno;
+            break;
+        }
+
+        if(result == 0) {
+            break;
+        }
+
+        length += result;
+        g_atomic_pointer_set(&stream->length, length);
+    }
+
+    g_atomic_int_set(&stream->finished, 1);
+
+    return NULL;
+}
+
+gboolean streamUpdate(gpointer data) {
+    StreamSource *stream = state.stream;
+    gsize length = g_atomic_pointer_get(&stream->length);
+    bool finished = g_atomic_int_get(&stream->finished);
+    bool paused = g_atomic_int_get(&stream->paused);
+
+    if(paused != state.streamPaused) {
+        state.streamPaused = paused;
+        updateTitle();
+    }
+
+    if(length != state.fileLength) {
+        // Only ever grows, everything already below it stays where it is
+        state.fileLength = length;
+        state.fileNumLines = (length + LINE_LENGTH - 1) / LINE_LENGTH;
+
+        updateSizeRequests();
+
+        // Only the end moves. Reconfiguring the whole adjustment would cut off a smooth scroll 10 times a second.
+        if(state.scrollAdj && state.fontHeight) {
+            gtk_adjustment_set_upper(state.scrollAdj, state.widgetHeight % state.fontHeight ? state.fileNumLines + 1 : state.fileNumLines);
+            streamRequestView(gtk_adjustment_get_value(state.scrollAdj));
+        }
+
+        if(state.viewWidgetsBox) {
+            gtk_widget_queue_draw(state.viewWidgetsBox);
+        }
+    }
+
+    if(!finished) {
+        return G_SOURCE_CONTINUE;
+    }
+
+    g_thread_join(stream->thread);
+    stream->thread = NULL;
+    state.streamTimerId = 0;
+    state.streamPaused = FALSE;
+    updateTitle();
+
+    if(stream->error) {
+        GtkWidget *errorDialog = gtk_message_dialog_new(GTK_WINDOW(state.window), GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT, GTK_MESSAGE_ERROR, GTK_BUTTONS_CLOSE, "Reading stopped after %lu bytes: %s", state.fileLength, strerror(stream->error));
+        gtk_dialog_run(GTK_DIALOG(errorDialog));
+        gtk_widget_destroy(errorDialog);
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+bool startStream(int fd) {
+    StreamSource *stream = NULL;
+    struct statfs spillFs = {0};
+    ulong readMB = STREAM_DEFAULT_READ_MB;
+
+    // Address space for all of it up front so the data stays one flat buffer like a mapped file
+    void *base = mmap(NULL, STREAM_MAX_LENGTH, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(base == MAP_FAILED) {
+        return FALSE;
+    }
+
+    stream = calloc(1, sizeof(StreamSource));
+    stream->fd = fd;
+    stream->spillFd = -1;
+    stream->base = base;
+
+    if(state.session && g_key_file_has_key(state.session, "Stream", "readMB", NULL)) {
+        readMB = g_key_file_get_uint64(state.session, "Stream", "readMB", NULL);
+    }
+    stream->wanted = MIN(readMB * 1024 * 1024, STREAM_MAX_LENGTH);
+
+    // The cache is normally on disk where the temp directory is often tmpfs, which would only be memory again
+    stream->spillDir = g_build_filename(g_get_user_cache_dir(), "jafhe", NULL);
+    g_mkdir_with_parents(stream->spillDir, 0700);
+    if(statfs(stream->spillDir, &spillFs) == 0 && spillFs.f_type == TMPFS_MAGIC) {
+        g_warning("%s is on tmpfs, streams past %d MB will be held in memory", stream->spillDir, STREAM_MEMORY_LIMIT / (1024 * 1024));
+    }
+
+    state.stream = stream;
+    state.fileBuffer = base;
+    state.fileLength = 0;
+    state.fileNumLines = 0;
+
+    state.streamTimerId = g_timeout_add(STREAM_UPDATE_INTERVAL_MS, streamUpdate, NULL);
+    stream->thread = g_thread_new("stream", streamReader, stream);
+
+    return TRUE;
+}
+
+void stopStream() {
+    StreamSource *stream = state.stream;
+
+    if(!stream) {
+        return;
+    }
+
+    state.stream = NULL;
+
+    g_atomic_int_set(&stream->cancelled, 1);
+    if(stream->thread) {
+        g_thread_join(stream->thread);
+    }
+
+    if(state.streamTimerId) {
+        g_source_remove(state.streamTimerId);
+        state.streamTimerId = 0;
+    }
+
+    munmap(stream->base, STREAM_MAX_LENGTH);
+    if(stream->spillFd >= 0) {
+        close(stream->spillFd);
+    }
+
+    state.fileBuffer = NULL;
+    state.streamPaused = FALSE;
+    g_free(stream->spillDir);
+    free(stream);
+}
+
+void streamRequestView(double value) {
+    // Reading carries on while the view stays within STREAM_READAHEAD_BYTES of the end
+    gsize wanted = ((ulong) value + state.numLines) * LINE_LENGTH + STREAM_READAHEAD_BYTES;
+
+    if(state.stream && wanted > g_atomic_pointer_get(&state.stream->wanted)) {
+        g_atomic_pointer_set(&state.stream->wanted, MIN(wanted, STREAM_MAX_LENGTH));
+    }
+}
+
+void startPrefetch() {
+    if(!state.fileMapped) {
+        // Everything is already in memory
+        return;
+    }
+
+    state.prefetchNumChunks = (state.fileLength + PREFETCH_CHUNK_SIZE - 1) / PREFETCH_CHUNK_SIZE;
+    state.prefetchChunkState = calloc(state.prefetchNumChunks, 1);
+    state.prefetchChunkState[0] = PREFETCH_CHUNK_SEEN; // The first screen can't be prefetched, don't count it as a miss
+
+    state.prefetchViewFirst = 0;
+    state.prefetchViewLast = 0;
+    state.prefetchDirection = 1;
+    state.prefetchVelocity = 0;
+    state.prefetchLastValue = 0;
+    state.prefetchLastTime = g_get_monotonic_time();
+
+    state.prefetchIssued = 0;
+    state.prefetchCompleted = 0;
+    state.prefetchDropped = 0;
+    state.prefetchHits = 0;
+    state.prefetchMisses = 0;
+
+    state.prefetchPool = g_thread_pool_new(prefetchWorker, NULL, PREFETCH_THREADS, FALSE, NULL);
+}
+
+void stopPrefetch() {
+    if(!state.prefetchPool) {
+        return;
+    }
+
+    // No direction matches 0, so every task still queued goes through the stale path and frees itself
+    g_mutex_lock(&state.prefetchLock);
+    state.prefetchDirection = 0;
+    g_mutex_unlock(&state.prefetchLock);
+
+    g_thread_pool_free(state.prefetchPool, FALSE, TRUE);
+    state.prefetchPool = NULL;
+
+    g_debug("Prefetch: %lu issued, %lu completed, %lu dropped, %lu hits, %lu misses (%.1f%% hit rate)",
+            state.prefetchIssued, state.prefetchCompleted, state.prefetchDropped, state.prefetchHits, state.prefetchMisses,
+            state.prefetchHits + state.prefetchMisses ? 100.0 * state.prefetchHits / (state.prefetchHits + state.prefetchMisses) : 0.0);
+
+    free(state.prefetchChunkState);
+    state.prefetchChunkState = NULL;
+    state.prefetchNumChunks = 0;
+}
+
+void prefetchWorker(gpointer data, gpointer userData) {
+    PrefetchTask *task = data;
+    bool stale = FALSE;
+
+    g_mutex_lock(&state.prefetchLock);
+    // Drop chunks the user has turned around on or already scrolled past
+    if(task->direction != state.prefetchDirection) {
+        stale = TRUE;
+    }
+    else if(task->direction > 0 && task->chunk < state.prefetchViewFirst) {
+        stale = TRUE;
+    }
+    else if(task->direction < 0 && task->chunk > state.prefetchViewLast) {
+        stale = TRUE;
+    }
+
+    if(stale) {
+        state.prefetchChunkState[task->chunk] &= ~PREFETCH_CHUNK_QUEUED;
+        state.prefetchDropped++;
+    }
+    g_mutex_unlock(&state.prefetchLock);
+
+    if(!stale) {
+        ulong start = task->chunk * PREFETCH_CHUNK_SIZE;
+        ulong length = MIN(PREFETCH_CHUNK_SIZE, state.fileLength - start);
+        long pageSize = sysconf(_SC_PAGESIZE);
+        volatile byte sink = 0;
+
+        madvise(state.fileBuffer + start, length, MADV_WILLNEED);
+
+        // WILLNEED is only a hint (and a no-op on some network filesystems) so fault the pages in here
+        // rather than on the main thread during the next draw
+        for(ulong i = 0; i < length; i += pageSize) {
+            sink = state.fileBuffer[start + i];
+        }
+        (void) sink;
+
+        g_mutex_lock(&state.prefetchLock);
+        state.prefetchChunkState[task->chunk] = (state.prefetchChunkState[task->chunk] & ~PREFETCH_CHUNK_QUEUED) | PREFETCH_CHUNK_READY;
+        state.prefetchCompleted++;
+        g_mutex_unlock(&state.prefetchLock);
+    }
+
+    free(task);
+}
+
+void updatePrefetch(double value) {
+    if(!state.prefetchPool || state.fileLength == 0) {
+        return;
+    }
+
+    gint64 now = g_get_monotonic_time();
+    double delta = value - state.prefetchLastValue;
+    double elapsed = (double) (now - state.prefetchLastTime) / G_USEC_PER_SEC;
+    int direction = state.prefetchDirection;
+
+    if(delta > 0) {
+        direction = 1;
+    }
+    else if(delta < 0) {
+        direction = -1;
+    }
+
+    if(elapsed > 0 && elapsed < PREFETCH_LOOKAHEAD_SEC) {
+        state.prefetchVelocity = 0.7 * state.prefetchVelocity + 0.3 * (fabs(delta) / elapsed);
+    }
+    else {
+        // Scrolling stopped for a while, start over from a single step
+        state.prefetchVelocity = 0;
+    }
+
+    state.prefetchLastValue = value;
+    state.prefetchLastTime = now;
 
-    state.file = fopen(state.fileFullName, "r");
+    ulong viewStart = (ulong) value * LINE_LENGTH;
+    ulong viewEnd = viewStart + (ulong) MAX(state.numLines, 1) * LINE_LENGTH;
+    viewStart = MIN(viewStart, state.fileLength - 1);
+    viewEnd = MIN(viewEnd, state.fileLength);
 
-    fseek(state.file, 0, SEEK_END);
-    state.fileLength = ftell(state.file);
-    fseek(state.file, 0, SEEK_SET);
+    // Look ahead far enough to cover where the view will be in PREFETCH_LOOKAHEAD_SEC at the current speed
+    ulong window = (ulong) (state.prefetchVelocity * PREFETCH_LOOKAHEAD_SEC) * LINE_LENGTH;
+    window = MAX(window, (ulong) PREFETCH_MIN_SCREENS * MAX(state.numLines, 1) * LINE_LENGTH);
+    window = MIN(window, PREFETCH_MAX_BYTES);
+
+    ulong firstChunk = viewStart / PREFETCH_CHUNK_SIZE;
+    ulong lastChunk = (viewEnd - 1) / PREFETCH_CHUNK_SIZE;
+    ulong aheadFirst = 0;
+    ulong aheadLast = 0;
+
+    if(direction > 0) {
+        aheadFirst = lastChunk + 1;
+        aheadLast = MIN(viewEnd + window, state.fileLength - 1) / PREFETCH_CHUNK_SIZE;
+    }
+    else {
+        aheadFirst = viewStart > window ? (viewStart - window) / PREFETCH_CHUNK_SIZE : 0;
+        aheadLast = firstChunk > 0 ? firstChunk - 1 : 0;
+    }
+
+    g_mutex_lock(&state.prefetchLock);
+
+    state.prefetchViewFirst = firstChunk;
+    state.prefetchViewLast = lastChunk;
+    state.prefetchDirection = direction;
+
+    for(ulong i = firstChunk; i <= lastChunk; i++) {
+        if(!(state.prefetchChunkState[i] & PREFETCH_CHUNK_SEEN)) {
+            if(state.prefetchChunkState[i] & PREFETCH_CHUNK_READY) {
+                state.prefetchHits++;
+            }
+            else {
+                state.prefetchMisses++;
+            }
+
+            state.prefetchChunkState[i] |= PREFETCH_CHUNK_SEEN;
+        }
+    }
+
+    if(aheadFirst <= aheadLast && !(direction < 0 && firstChunk == 0)) {
+        // Queue closest to the view first so the next frame's chunk is read before the far ones
+        for(ulong n = 0; n <= aheadLast - aheadFirst; n++) {
+            ulong chunk = direction > 0 ? aheadFirst + n : aheadLast - n;
+
+            if(state.prefetchChunkState[chunk] & (PREFETCH_CHUNK_QUEUED | PREFETCH_CHUNK_READY | PREFETCH_CHUNK_SEEN)) {
+                continue;
+            }
+
+            PrefetchTask *task = malloc(sizeof(PrefetchTask));
+            task->chunk = chunk;
+            task->direction = direction;
+
+            state.prefetchChunkState[chunk] |= PREFETCH_CHUNK_QUEUED;
+            state.prefetchIssued++;
+            g_thread_pool_push(state.prefetchPool, task, NULL);
+        }
+    }
+
+    g_mutex_unlock(&state.prefetchLock);
+}
+
+void openMenuAction(GtkMenuItem *menuItem) {
+    GtkWidget *dialog = NULL;
+    gint dialogResult = 0;
+
+    dialog = gtk_file_chooser_dialog_new("Open File", GTK_WINDOW(state.window), GTK_FILE_CHOOSER_ACTION_OPEN, "Cancel", GTK_RESPONSE_CANCEL, "Open", GTK_RESPONSE_ACCEPT, NULL);
+
+    dialogResult = gtk_dialog_run(GTK_DIALOG(dialog));
+    if(dialogResult == GTK_RESPONSE_ACCEPT) {
+        char *filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
+        openFile(filename);
+        g_free(filename);
+    }
+
+    updateTitle();
+
+    gtk_widget_destroy(dialog);
+}
+
+void gotoActivateCallback(GtkWidget *widget, gpointer data) {
+    gtk_dialog_response(GTK_DIALOG(data), GTK_RESPONSE_ACCEPT);
+}
+
+void openGotoDialog() {
+    GtkWidget *dialog = NULL;
+    GtkWidget *dialogCBox = NULL;
+    GtkWidget *entry = NULL;
+
+    bool done = FALSE;
+    gint response = 0;
+
+    dialog = gtk_dialog_new_with_buttons("Jump To Offset", GTK_WINDOW(state.window), GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT, "Cancel", GTK_RESPONSE_CANCEL, "Open", GTK_RESPONSE_ACCEPT, NULL);
+    gtk_widget_set_events(dialog, GDK_KEY_PRESS_MASK);
+
+    entry = gtk_entry_new();
+    g_signal_connect(entry, "activate", G_CALLBACK(gotoActivateCallback), dialog); // Done this way because gtk_dialog_add_action_widget doesn't working
+    dialogCBox = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
+    gtk_box_pack_start(GTK_BOX(dialogCBox), entry, FALSE, FALSE, 0);
+    gtk_widget_show(entry);
+
+    while(!done) {
+        response = gtk_dialog_run(GTK_DIALOG(dialog));
+
+        if(response == GTK_RESPONSE_ACCEPT) {
+            const char *entryText = gtk_entry_get_text(GTK_ENTRY(entry));
+            char *rest = NULL;
+            long offset = 0;
+
+            offset = strtol(entryText, &rest, 16);
+
+            if(strlen(rest) != 0) {
+                GtkWidget *invalidDialog = gtk_message_dialog_new(GTK_WINDOW(dialog), GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT, GTK_MESSAGE_ERROR, GTK_BUTTONS_CLOSE, "Invalid Offset: \"%s\"", entryText);
+                gtk_dialog_run(GTK_DIALOG(invalidDialog));
+                gtk_widget_destroy(invalidDialog);
+                gtk_entry_set_text(GTK_ENTRY(entry), "");
+                gtk_widget_grab_focus(GTK_WIDGET(entry));
+            } 
+            else {
+                // Success
+                // TODO(Adin): Update for resizable lines
+                offset >>= 4; // Divide by line length (2^4 or 16)
+                int adjUpper = gtk_adjustment_get_upper(state.scrollAdj);
+                int adjPSize = gtk_adjustment_get_page_size(state.scrollAdj);
+                CLAMP_VALUE(offset, 0, adjUpper - adjPSize);
+                gtk_adjustment_set_value(state.scrollAdj, offset);
+                done = TRUE;
+            }
+            
+        }
+        else {
+            done = TRUE;
+        }
+    }
+
+    gtk_widget_destroy(dialog);
+}
+
+void gotoMenuAction(GtkWidget *widget) {
+    if(state.file) {
+        openGotoDialog();
+    }
+}
+
+void fontMenuAction(GtkMenuItem *menuItem) {
+    GtkWidget *dialog = NULL;
+    gint dialogResult = 0;
+
+    dialog = gtk_font_chooser_dialog_new("Choose Font", GTK_WINDOW(state.window));
+    gtk_font_chooser_set_font_desc(GTK_FONT_CHOOSER(dialog), state.fontDesc);
+
+    dialogResult = gtk_dialog_run(GTK_DIALOG(dialog));
+    if(dialogResult == GTK_RESPONSE_OK) {
+        PangoFontDescription *fontDesc = gtk_font_chooser_get_font_desc(GTK_FONT_CHOOSER(dialog));
+
+        updateFont(pango_font_description_copy(fontDesc));
+    }
+
+    gtk_widget_destroy(dialog);
+}
+
+void formatHex(char *dest, const byte *src, ulong count, uint lineLength) {
+    static const char hexDigits[] = "0123456789ABCDEF";
+    uint column = 0;
+
+    // Every byte is exactly 3 characters ("XX" and a separator) so chunks can be formatted independently.
+    // The last separator is left for the caller to overwrite with a terminator.
+    for(ulong i = 0; i < count; i++) {
+        column++;
+
+        dest[0] = hexDigits[src[i] >> 4];
+        dest[1] = hexDigits[src[i] & 0xF];
+        dest[2] = ' ';
+
+        if(column == lineLength) {
+            dest[2] = '\n';
+            column = 0;
+        }
+
+        dest += 3;
+    }
+}
+
+bool getSelection(ulong *start, ulong *end) {
+    if(!state.hasSelection || !state.file) {
+        return FALSE;
+    }
+
+    *start = MIN(state.selectionAnchor, state.selectionCursor);
+    *end = MAX(state.selectionAnchor, state.selectionCursor);
+
+    return TRUE;
+}
+
+void clearSelection() {
+    state.hasSelection = FALSE;
+    state.selecting = FALSE;
+    state.selectionAnchor = 0;
+    state.selectionCursor = 0;
+
+    if(state.viewWidgetsBox) {
+        gtk_widget_queue_draw(state.viewWidgetsBox);
+    }
+}
+
+ulong offsetAtPoint(GtkWidget *widget, double x, double y) {
+    double scrollValue = gtk_adjustment_get_value(state.scrollAdj);
+    uint adjValue = scrollValue;
+    int yOffset = round((scrollValue - adjValue) * state.fontHeight);
+    uint cellWidth = state.fontWidth;
+
+    if(widget == state.hexBox) {
+        cellWidth = 3 * state.fontWidth;
+    }
+
+    long line = adjValue + (long) floor((y + yOffset) / state.fontHeight);
+    long column = (long) floor((x - TEXT_MARGIN_PX) / cellWidth);
+    CLAMP_VALUE(column, 0, LINE_LENGTH - 1);
+
+    long offset = line * LINE_LENGTH + column;
+    CLAMP_VALUE(offset, 0, (long) state.fileLength - 1);
+
+    return offset;
+}
+
+bool onButtonPress(GtkWidget *widget, GdkEventButton *event) {
+    if(!state.file || state.fileLength == 0 || event->button != GDK_BUTTON_PRIMARY) {
+        return FALSE;
+    }
+
+    ulong offset = offsetAtPoint(widget, event->x, event->y);
+
+    if(!(event->state & GDK_SHIFT_MASK) || !state.hasSelection) {
+        state.selectionAnchor = offset;
+    }
+    state.selectionCursor = offset;
+    state.hasSelection = TRUE;
+    state.selecting = TRUE;
+
+    gtk_widget_queue_draw(state.viewWidgetsBox);
+
+    return TRUE;
+}
+
+bool onMotion(GtkWidget *widget, GdkEventMotion *event) {
+    if(!state.selecting) {
+        return FALSE;
+    }
+
+    ulong offset = offsetAtPoint(widget, event->x, event->y);
+
+    if(offset != state.selectionCursor) {
+        state.selectionCursor = offset;
+        gtk_widget_queue_draw(state.viewWidgetsBox);
+    }
+
+    return TRUE;
+}
+
+bool onButtonRelease(GtkWidget *widget, GdkEventButton *event) {
+    if(event->button == GDK_BUTTON_PRIMARY) {
+        state.selecting = FALSE;
+    }
+
+    return FALSE;
+}
+
+void clipboardGetFile(GtkSelectionData *selectionData, guint info, ClipboardRange *range) {
+    char *uri = g_filename_to_uri(range->path, NULL, NULL);
+
+    if(!uri) {
+        return;
+    }
+
+    if(info == CLIPBOARD_URIS) {
+        char *uris[] = {uri, NULL};
+        gtk_selection_data_set_uris(selectionData, uris);
+    }
+    else if(info == CLIPBOARD_GNOME_FILES) {
+        char *files = g_strdup_printf("copy\n%s", uri);
+        gtk_selection_data_set(selectionData, gtk_selection_data_get_target(selectionData), 8, (const guchar *) files, strlen(files));
+        g_free(files);
+    }
+    else {
+        // Already formatted by the export, it only has to be handed over.
+        // Selection data is limited to G_MAXINT bytes, past that only the file targets work.
+        int fd = open(range->path, O_RDONLY);
+        struct stat fileStat = {0};
+
+        if(fd >= 0 && fstat(fd, &fileStat) == 0 && fileStat.st_size > 0 && fileStat.st_size <= G_MAXINT) {
+            void *data = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if(data != MAP_FAILED) {
+                madvise(data, fileStat.st_size, MADV_SEQUENTIAL);
+
+                if(range->format == CLIPBOARD_RAW) {
+                    gtk_selection_data_set(selectionData, gtk_selection_data_get_target(selectionData), 8, data, fileStat.st_size);
+                }
+                else {
+                    gtk_selection_data_set_text(selectionData, data, fileStat.st_size);
+                }
+
+                munmap(data, fileStat.st_size);
+            }
+        }
+
+        if(fd >= 0) {
+            close(fd);
+        }
+    }
+
+    g_free(uri);
+}
+
+void clipboardGet(GtkClipboard *clipboard, GtkSelectionData *selectionData, guint info, gpointer data) {
+    ClipboardRange *range = data;
+
+    if(range->path) {
+        clipboardGetFile(selectionData, info, range);
+        return;
+    }
+
+    if(!state.fileBuffer || range->start + range->length > state.fileLength) {
+        return;
+    }
+
+    // Nothing is formatted until a target actually asks for the data
+    if(range->format == CLIPBOARD_RAW) {
+        gtk_selection_data_set(selectionData, gtk_selection_data_get_target(selectionData), 8, state.fileBuffer + range->start, range->length);
+    }
+    else {
+        ulong textLength = range->length * 3; // "XX" and a separator per byte, the last separator becomes the terminator
+        char *text = malloc(textLength);
+
+        if(!text) {
+            // Leaving the selection data unset refuses the request
+            g_warning("Couldn't allocate %lu bytes for the clipboard", textLength);
+            return;
+        }
+
+        formatHex(text, state.fileBuffer + range->start, range->length, LINE_LENGTH);
+        text[textLength - 1] = '\0';
+
+        gtk_selection_data_set_text(selectionData, text, textLength - 1);
+
+        free(text);
+    }
+}
+
+void freeClipboardRange(ClipboardRange *range) {
+    if(range) {
+        g_free(range->path);
+        free(range);
+    }
+}
+
+void clipboardClear(GtkClipboard *clipboard, gpointer data) {
+    ClipboardRange *range = data;
+
+    if(state.clipboardRange == range) {
+        state.clipboardRange = NULL;
+    }
+
+    // A newer copy of the same format has already been renamed over it
+    if(range->path && !(state.clipboardRange && state.clipboardRange->path && strcmp(state.clipboardRange->path, range->path) == 0)) {
+        unlink(range->path);
+    }
+
+    freeClipboardRange(range);
+}
+
+void claimClipboard(ClipboardRange *range) {
+    static const GtkTargetEntry hexTargets[] = {
+        {"UTF8_STRING", 0, CLIPBOARD_HEX},
+        {"text/plain;charset=utf-8", 0, CLIPBOARD_HEX},
+        {"text/plain", 0, CLIPBOARD_HEX},
+        {"TEXT", 0, CLIPBOARD_HEX},
+        {"STRING", 0, CLIPBOARD_HEX},
+    };
+    static const GtkTargetEntry rawTargets[] = {
+        {"application/octet-stream", 0, CLIPBOARD_RAW},
+    };
+
+    GtkClipboard *clipboard = gtk_widget_get_clipboard(state.window, GDK_SELECTION_CLIPBOARD);
+    GtkTargetList *targetList = NULL;
+    GtkTargetEntry *targets = NULL;
+    int targetCount = 0;
+
+    if(range->format == CLIPBOARD_RAW) {
+        targetList = gtk_target_list_new(rawTargets, G_N_ELEMENTS(rawTargets));
+    }
+    else {
+        targetList = gtk_target_list_new(hexTargets, G_N_ELEMENTS(hexTargets));
+    }
+
+    // An exported copy can also be pasted as a file, which spares the target holding all of it in memory
+    if(range->path) {
+        gtk_target_list_add_uri_targets(targetList, CLIPBOARD_URIS);
+        gtk_target_list_add(targetList, gdk_atom_intern_static_string("x-special/gnome-copied-files"), 0, CLIPBOARD_GNOME_FILES);
+    }
+
+    targets = gtk_target_table_new_from_list(targetList, &targetCount);
+
+    // Set first so clearing the previous range can tell its file was replaced
+    state.clipboardRange = range;
+    gtk_clipboard_set_with_data(clipboard, targets, targetCount, clipboardGet, clipboardClear, range);
+
+    gtk_target_table_free(targets, targetCount);
+    gtk_target_list_unref(targetList);
+}
+
+void copySelection(int format) {
+    ulong start = 0;
+    ulong end = 0;
+
+    if(!getSelection(&start, &end) || state.exportJob) {
+        return;
+    }
+
+    ClipboardRange *range = calloc(1, sizeof(ClipboardRange));
+    range->start = start;
+    range->length = end - start + 1;
+    range->format = format;
+
+    if(range->length <= CLIPBOARD_INLINE_BYTES) {
+        // Only the range is handed over, clipboardGet produces the data when it's pasted
+        claimClipboard(range);
+        return;
+    }
+
+    // Too big to format while a paste waits on us, it's exported off the main thread and claimed when it lands.
+    // The same file is reused by every copy so the cache never holds more than one per format.
+    char *directory = g_build_filename(g_get_user_cache_dir(), "jafhe", NULL);
+    g_mkdir_with_parents(directory, 0700);
+    range->path = g_build_filename(directory, format == CLIPBOARD_RAW ? "clipboard.bin" : "clipboard.txt", NULL);
+    g_free(directory);
+
+    startExport(range->path, format == CLIPBOARD_RAW ? EXPORT_RAW : EXPORT_HEX, range->start, range->length, range);
+}
+
+void copyHexMenuAction(GtkMenuItem *menuItem) {
+    copySelection(CLIPBOARD_HEX);
+}
+
+void copyRawMenuAction(GtkMenuItem *menuItem) {
+    copySelection(CLIPBOARD_RAW);
+}
+
+void selectAllMenuAction(GtkMenuItem *menuItem) {
+    if(!state.file || state.fileLength == 0) {
+        return;
+    }
+
+    state.selectionAnchor = 0;
+    state.selectionCursor = state.fileLength - 1;
+    state.hasSelection = TRUE;
+
+    gtk_widget_queue_draw(state.viewWidgetsBox);
+}
+
+void exportWrite(ExportJob *job, const char *data, ulong length) {
+    ulong written = 0;
+
+    while(written < length && !job->error) {
+        ssize_t result = write(job->outFd, data + written, length - written);
+
+        if(result < 0) {
+            if(errno != EINTR) {
+                job->error = errno;
+            }
+        }
+        else {
+            written += result;
+        }
+    }
+}
+
+void exportFlush(ExportJob *job) {
+    exportWrite(job, job->writeBuffer, job->writeUsed);
+    job->writeUsed = 0;
+}
+
+char *exportReserve(ExportJob *job, ulong length) {
+    if(job->writeUsed + length > EXPORT_WRITE_BUFFER) {
+        exportFlush(job);
+    }
+
+    char *out = job->writeBuffer + job->writeUsed;
+    job->writeUsed += length;
+
+    return out;
+}
+
+void exportPutString(ExportJob *job, const char *str) {
+    ulong length = strlen(str);
+
+    memcpy(exportReserve(job, length), str, length);
+}
+
+void putHexByte(char *dest, byte value) {
+    static const char hexDigits[] = "0123456789ABCDEF";
+
+    dest[0] = hexDigits[value >> 4];
+    dest[1] = hexDigits[value & 0xF];
+}
+
+void writeIhexRecord(ExportJob *job, byte type, uint address, const byte *data, uint count) {
+    char *out = exportReserve(job, 12 + count * 2); // ':', length, address, type, data, checksum, '\n'
+    byte sum = count + (address >> 8) + address + type;
+
+    out[0] = ':';
+    putHexByte(out + 1, count);
+    putHexByte(out + 3, address >> 8);
+    putHexByte(out + 5, address);
+    putHexByte(out + 7, type);
+
+    for(uint i = 0; i < count; i++) {
+        putHexByte(out + 9 + i * 2, data[i]);
+        sum += data[i];
+    }
+
+    putHexByte(out + 9 + count * 2, -sum);
+    out[11 + count * 2] = '\n';
+}
+
+void writeSrecRecord(ExportJob *job, char type, uint address, uint addressBytes, const byte *data, uint count) {
+    char *out = exportReserve(job, 7 + (addressBytes + count) * 2); // 'S', type, count, address, data, checksum, '\n'
+    byte recordCount = addressBytes + count + 1;
+    byte sum = recordCount;
+
+    out[0] = 'S';
+    out[1] = type;
+    putHexByte(out + 2, recordCount);
+
+    for(uint i = 0; i < addressBytes; i++) {
+        byte addressByte = address >> ((addressBytes - i - 1) * 8);
+
+        putHexByte(out + 4 + i * 2, addressByte);
+        sum += addressByte;
+    }
+
+    out += 4 + addressBytes * 2;
+    for(uint i = 0; i < count; i++) {
+        putHexByte(out + i * 2, data[i]);
+        sum += data[i];
+    }
+
+    putHexByte(out + count * 2, ~sum);
+    out[count * 2 + 2] = '\n';
+}
+
+void exportEncodeChunk(ExportJob *job, const byte *src, ulong position, ulong count) {
+    switch(job->format) {
+        case EXPORT_RAW:
+            // Straight from the file buffer, there's nothing to encode
+            exportFlush(job);
+            exportWrite(job, (const char *) src, count);
+            break;
+
+        case EXPORT_C_ARRAY:
+            for(ulong i = 0; i < count; i++) {
+                char piece[8] = {0}; // Indent, "0xAB" and ",\n" at most
+                int length = 0;
+
+                if((position + i) % EXPORT_C_ARRAY_COLUMNS == 0) {
+                    piece[length++] = ' ';
+                    piece[length++] = ' ';
+                }
+
+                piece[length++] = '0';
+                piece[length++] = 'x';
+                putHexByte(piece + length, src[i]);
+                length += 2;
+
+                if(position + i + 1 == job->length) {
+                    piece[length++] = '\n';
+                }
+                else if((position + i + 1) % EXPORT_C_ARRAY_COLUMNS == 0) {
+                    piece[length++] = ',';
+                    piece[length++] = '\n';
+                }
+                else {
+                    piece[length++] = ',';
+                    piece[length++] = ' ';
+                }
+
+                memcpy(exportReserve(job, length), piece, length);
+            }
+            break;
+
+        case EXPORT_BASE64:
+            for(ulong done = 0; done < count; done += EXPORT_BASE64_BLOCK) {
+                ulong n = MIN(EXPORT_BASE64_BLOCK, count - done);
+                ulong reserved = (n / 3 + 1) * 4 + (n / 3 + 1) * 4 / 72 + 8;
+                char *out = exportReserve(job, reserved);
+                ulong encoded = g_base64_encode_step(src + done, n, TRUE, out, &job->base64State, &job->base64Save);
+
+                job->writeUsed -= reserved - encoded;
+            }
+            break;
+
+        case EXPORT_INTEL_HEX:
+            for(ulong i = 0; i < count;) {
+                ulong address = job->start + position + i;
+                uint upper = address >> 16;
+                uint n = MIN(EXPORT_RECORD_LENGTH, count - i);
+                n = MIN(n, 0x10000 - (address & 0xFFFF)); // Records can't wrap around a 64K segment
+
+                if(upper != job->ihexUpper) {
+                    byte upperBytes[2] = {upper >> 8, upper};
+
+                    writeIhexRecord(job, 0x04, 0, upperBytes, 2);
+                    job->ihexUpper = upper;
+                }
+
+                writeIhexRecord(job, 0x00, address & 0xFFFF, src + i, n);
+                i += n;
+            }
+            break;
+
+        case EXPORT_SREC:
+            for(ulong i = 0; i < count; i += EXPORT_RECORD_LENGTH) {
+                uint n = MIN(EXPORT_RECORD_LENGTH, count - i);
+
+                writeSrecRecord(job, '3', job->start + position + i, 4, src + i, n);
+            }
+            break;
+
+        case EXPORT_HEX:
+            // Chunks start on a line boundary so the lines come out the same as in one go
+            for(ulong i = 0; i < count; i += EXPORT_HEX_BLOCK) {
+                ulong n = MIN(EXPORT_HEX_BLOCK, count - i);
+
+                formatHex(exportReserve(job, n * 3), src + i, n, LINE_LENGTH);
+            }
+            break;
+    }
+}
+
+bool exportCopyRange(ExportJob *job) {
+    loff_t inOffset = job->start;
+    ulong done = 0;
+
+    // Let the kernel move the bytes (reflinks or server side copies where the filesystem can do it)
+    while(done < job->length && !g_atomic_int_get(&job->cancelled)) {
+        ssize_t result = copy_file_range(job->inFd, &inOffset, job->outFd, NULL, MIN(EXPORT_CHUNK_SIZE, job->length - done), 0);
+
+        if(result < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+
+            if(done == 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+                // Not supported between these files, use the buffered path instead
+                return FALSE;
+            }
+
+            job->error = errno;
+            return TRUE;
+        }
+
+        if(result == 0) {
+            // File shrank under us
+            job->error = EIO;
+            return TRUE;
+        }
+
+        done += result;
+        g_atomic_int_set(&job->progress, (double) done / job->length * EXPORT_PROGRESS_SCALE);
+    }
+
+    return TRUE;
+}
+
+gpointer exportWorker(gpointer data) {
+    ExportJob *job = data;
+    long pageSize = sysconf(_SC_PAGESIZE);
+    bool copied = FALSE;
+
+    switch(job->format) {
+        case EXPORT_RAW:
+            copied = job->inFd >= 0 && exportCopyRange(job);
+            break;
+
+        case EXPORT_C_ARRAY:
+            exportPutString(job, "unsigned char data[] = {\n");
+            break;
+
+        case EXPORT_SREC: {
+            const byte header[] = "jafhe";
+            writeSrecRecord(job, '0', 0, 2, header, sizeof(header) - 1);
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    for(ulong position = 0; !copied && position < job->length && !job->error && !g_atomic_int_get(&job->cancelled); position += EXPORT_CHUNK_SIZE) {
+        ulong count = MIN(EXPORT_CHUNK_SIZE, job->length - position);
+        const byte *src = state.fileBuffer + job->start + position;
+
+        if(state.fileMapped && position + count < job->length) {
+            // Start reading the next chunk while this one is encoded
+            ulong next = (job->start + position + count) & ~(pageSize - 1);
+            madvise(state.fileBuffer + next, MIN(EXPORT_CHUNK_SIZE, job->fileLength - next), MADV_WILLNEED);
+        }
+
+        exportEncodeChunk(job, src, position, count);
+        g_atomic_int_set(&job->progress, (double) (position + count) / job->length * EXPORT_PROGRESS_SCALE);
+    }
+
+    if(!job->error && !g_atomic_int_get(&job->cancelled)) {
+        switch(job->format) {
+            case EXPORT_C_ARRAY: {
+                char footer[64] = {0};
+                snprintf(footer, 64, "};\nunsigned int data_len = %lu;\n", job->length);
+                exportPutString(job, footer);
+                break;
+            }
+
+            case EXPORT_BASE64: {
+                char *out = exportReserve(job, 8);
+                ulong encoded = g_base64_encode_close(TRUE, out, &job->base64State, &job->base64Save);
+                job->writeUsed -= 8 - encoded;
+                break;
+            }
+
+            case EXPORT_INTEL_HEX:
+                writeIhexRecord(job, 0x01, 0, NULL, 0);
+                break;
+
+            case EXPORT_SREC:
+                writeSrecRecord(job, '7', 0, 4, NULL, 0);
+                break;
+
+            case EXPORT_HEX:
+                // Drop the separator after the last byte, it's still in the write buffer
+                job->writeUsed--;
+                break;
+
+            default:
+                break;
+        }
+
+        exportFlush(job);
+
+        if(!job->error) {
+            job->completed = TRUE;
+        }
+    }
+
+    g_atomic_int_set(&job->finished, 1);
+    g_idle_add(exportFinished, job);
+
+    return NULL;
+}
+
+gboolean exportUpdateProgress(gpointer data) {
+    if(!state.exportJob) {
+        return G_SOURCE_REMOVE;
+    }
+
+    gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(state.exportProgressBar), (double) g_atomic_int_get(&state.exportJob->progress) / EXPORT_PROGRESS_SCALE);
+
+    return G_SOURCE_CONTINUE;
+}
+
+void exportDialogResponse(GtkWidget *dialog, gint response, gpointer data) {
+    if(state.exportJob) {
+        g_atomic_int_set(&state.exportJob->cancelled, 1);
+    }
+}
+
+void finishExport(bool quiet) {
+    ExportJob *job = state.exportJob;
+
+    if(!job) {
+        return;
+    }
+
+    state.exportJob = NULL;
+    g_thread_join(job->thread);
+
+    if(state.exportTimerId) {
+        g_source_remove(state.exportTimerId);
+        state.exportTimerId = 0;
+    }
+
+    if(state.exportDialog) {
+        gtk_widget_destroy(state.exportDialog);
+        state.exportDialog = NULL;
+        state.exportProgressBar = NULL;
+    }
+
+    close(job->outFd);
+
+    if(job->completed && rename(job->tempPath, job->path) != 0) {
+        job->error = errno;
+        job->completed = FALSE;
+    }
+
+    if(!job->completed) {
+        // Whatever was at the path before is still there untouched
+        unlink(job->tempPath);
+    }
+
+    if(job->clipboardRange) {
+        if(job->completed) {
+            claimClipboard(job->clipboardRange);
+        }
+        else {
+            freeClipboardRange(job->clipboardRange);
+        }
+    }
+
+    if(job->error && !quiet) {
+        GtkWidget *errorDialog = gtk_message_dialog_new(GTK_WINDOW(state.window), GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT, GTK_MESSAGE_ERROR, GTK_BUTTONS_CLOSE, "%s failed: %s", job->clipboardRange ? "Copy" : "Export", strerror(job->error));
+        gtk_dialog_run(GTK_DIALOG(errorDialog));
+        gtk_widget_destroy(errorDialog);
+    }
+
+    free(job->writeBuffer);
+    free(job->path);
+    g_free(job->tempPath);
+    free(job);
+}
+
+gboolean exportFinished(gpointer data) {
+    ExportJob *job = data;
+
+    // The export may already have been cleaned up by closing the file or replaced by a new one.
+    // A new job can reuse the freed address, so it also has to have finished itself before it's joined here.
+    if(job == state.exportJob && g_atomic_int_get(&job->finished)) {
+        finishExport(FALSE);
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+void stopExport() {
+    if(state.exportJob) {
+        g_atomic_int_set(&state.exportJob->cancelled, 1);
+        finishExport(TRUE);
+    }
+}
+
+void startExport(char *path, int format, ulong start, ulong length, ClipboardRange *clipboardRange) {
+    GtkWidget *dialogCBox = NULL;
+    struct stat targetStat = {0};
+    struct stat sourceStat = {0};
+    bool targetExists = stat(path, &targetStat) == 0;
+
+    // Truncating the mapped source would fault the view and the worker, and a failed export would then delete it
+    if(targetExists && fstat(fileno(state.file), &sourceStat) == 0 && targetStat.st_dev == sourceStat.st_dev && targetStat.st_ino == sourceStat.st_ino) {
+        GtkWidget *errorDialog = gtk_message_dialog_new(GTK_WINDOW(state.window), GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT, GTK_MESSAGE_ERROR, GTK_BUTTONS_CLOSE, "Can't export over \"%s\", it's the open file", path);
+        gtk_dialog_run(GTK_DIALOG(errorDialog));
+        gtk_widget_destroy(errorDialog);
+        freeClipboardRange(clipboardRange);
+        return;
+    }
+
+    // Next to the target so the rename stays on one filesystem
+    char *directory = g_path_get_dirname(path);
+    char *baseName = g_path_get_basename(path);
+    char *tempPath = g_strdup_printf("%s/.%s.XXXXXX", directory, baseName);
+    g_free(directory);
+    g_free(baseName);
+
+    int outFd = g_mkstemp(tempPath);
+    if(outFd < 0) {
+        GtkWidget *errorDialog = gtk_message_dialog_new(GTK_WINDOW(state.window), GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT, GTK_MESSAGE_ERROR, GTK_BUTTONS_CLOSE, "Couldn't open \"%s\": %s", path, strerror(errno));
+        gtk_dialog_run(GTK_DIALOG(errorDialog));
+        gtk_widget_destroy(errorDialog);
+        g_free(tempPath);
+        freeClipboardRange(clipboardRange);
+        return;
+    }
+
+    // mkstemp makes it private, an overwritten file keeps its mode
+    fchmod(outFd, targetExists ? targetStat.st_mode & 07777 : 0644);
+
+    ExportJob *job = calloc(1, sizeof(ExportJob));
+    job->path = strdup(path);
+    job->tempPath = tempPath;
+    job->format = format;
+    job->start = start;
+    job->length = length;
+    job->fileLength = state.fileLength;
+    job->inFd = state.stream ? -1 : fileno(state.file); // Only the buffer can be copied from a stream
+    job->outFd = outFd;
+    job->writeBuffer = malloc(EXPORT_WRITE_BUFFER);
+    job->clipboardRange = clipboardRange;
+
+    state.exportDialog = gtk_dialog_new_with_buttons(clipboardRange ? "Copying" : "Exporting", GTK_WINDOW(state.window), GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT, "Cancel", GTK_RESPONSE_CANCEL, NULL);
+    g_signal_connect(state.exportDialog, "response", G_CALLBACK(exportDialogResponse), NULL);
+
+    state.exportProgressBar = gtk_progress_bar_new();
+    dialogCBox = gtk_dialog_get_content_area(GTK_DIALOG(state.exportDialog));
+    gtk_box_pack_start(GTK_BOX(dialogCBox), state.exportProgressBar, FALSE, FALSE, 0);
+    gtk_widget_show_all(state.exportDialog);
+
+    state.exportJob = job;
+    state.exportTimerId = g_timeout_add(EXPORT_PROGRESS_INTERVAL_MS, exportUpdateProgress, NULL);
+    job->thread = g_thread_new("export", exportWorker, job);
+}
+
+void exportMenuAction(GtkMenuItem *menuItem) {
+    static const char *formatNames[] = {"Raw", "C Array", "Base64", "Intel HEX", "Motorola S-Record", "Hex"};
+
+    GtkWidget *dialog = NULL;
+    GtkWidget *grid = NULL;
+    GtkWidget *formatCombo = NULL;
+    GtkWidget *startEntry = NULL;
+    GtkWidget *endEntry = NULL;
+
+    ulong start = 0;
+    ulong end = 0;
+    char buffer[17] = {0};
+
+    bool done = FALSE;
+    gint response = 0;
+
+    if(!state.file || state.fileLength == 0 || state.exportJob) {
+        return;
+    }
+
+    if(!getSelection(&start, &end)) {
+        start = 0;
+        end = state.fileLength - 1;
+    }
+
+    dialog = gtk_dialog_new_with_buttons("Export Range", GTK_WINDOW(state.window), GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT, "Cancel", GTK_RESPONSE_CANCEL, "Export", GTK_RESPONSE_ACCEPT, NULL);
+
+    grid = gtk_grid_new();
+    gtk_grid_set_row_spacing(GTK_GRID(grid), BOX_SPACING_PX);
+    gtk_grid_set_column_spacing(GTK_GRID(grid), BOX_SPACING_PX);
+
+    formatCombo = gtk_combo_box_text_new();
+    for(int i = 0; i < G_N_ELEMENTS(formatNames); i++) {
+        gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(formatCombo), formatNames[i]);
+    }
+    gtk_combo_box_set_active(GTK_COMBO_BOX(formatCombo), EXPORT_RAW);
+
+    startEntry = gtk_entry_new();
+    snprintf(buffer, 17, "%lX", start);
+    gtk_entry_set_text(GTK_ENTRY(startEntry), buffer);
+
+    endEntry = gtk_entry_new();
+    snprintf(buffer, 17, "%lX", end);
+    gtk_entry_set_text(GTK_ENTRY(endEntry), buffer);
+
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Format"), 0, 0, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), formatCombo, 1, 0, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Start"), 0, 1, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), startEntry, 1, 1, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("End"), 0, 2, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), endEntry, 1, 2, 1, 1);
+
+    gtk_box_pack_start(GTK_BOX(gtk_dialog_get_content_area(GTK_DIALOG(dialog))), grid, FALSE, FALSE, 0);
+    gtk_widget_show_all(grid);
+
+    while(!done) {
+        response = gtk_dialog_run(GTK_DIALOG(dialog));
+
+        if(response == GTK_RESPONSE_ACCEPT) {
+            const char *startText = gtk_entry_get_text(GTK_ENTRY(startEntry));
+            const char *endText = gtk_entry_get_text(GTK_ENTRY(endEntry));
+            int format = gtk_combo_box_get_active(GTK_COMBO_BOX(formatCombo));
+            char *startRest = NULL;
+            char *endRest = NULL;
+
+            start = strtoul(startText, &startRest, 16);
+            end = strtoul(endText, &endRest, 16);
+
+            const char *problem = NULL;
+            if(strlen(startText) == 0 || strlen(startRest) != 0 || strlen(endText) == 0 || strlen(endRest) != 0) {
+                problem = "Invalid offset";
+            }
+            else if(start > end || end >= state.fileLength) {
+                problem = "Range is outside of the file";
+            }
+            else if((format == EXPORT_INTEL_HEX || format == EXPORT_SREC) && end > 0xFFFFFFFF) {
+                problem = "Intel HEX and S-Records can only address 4 GB";
+            }
+
+            if(problem) {
+                GtkWidget *invalidDialog = gtk_message_dialog_new(GTK_WINDOW(dialog), GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT, GTK_MESSAGE_ERROR, GTK_BUTTONS_CLOSE, "%s", problem);
+                gtk_dialog_run(GTK_DIALOG(invalidDialog));
+                gtk_widget_destroy(invalidDialog);
+                continue;
+            }
+
+            GtkWidget *chooser = gtk_file_chooser_dialog_new("Export To", GTK_WINDOW(dialog), GTK_FILE_CHOOSER_ACTION_SAVE, "Cancel", GTK_RESPONSE_CANCEL, "Save", GTK_RESPONSE_ACCEPT, NULL);
+            gtk_file_chooser_set_do_overwrite_confirmation(GTK_FILE_CHOOSER(chooser), TRUE);
+
+            if(gtk_dialog_run(GTK_DIALOG(chooser)) == GTK_RESPONSE_ACCEPT) {
+                char *filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(chooser));
+
+                gtk_widget_destroy(chooser);
+                gtk_widget_destroy(dialog);
+
+                startExport(filename, format, start, end - start + 1, NULL);
+                g_free(filename);
+                return;
+            }
+
+            gtk_widget_destroy(chooser);
+        }
+        else {
+            done = TRUE;
+        }
+    }
+
+    gtk_widget_destroy(dialog);
+}
+
+void scanJobWorker(gpointer data, gpointer userData) {
+    ScanJob *job = userData;
+    ScanChunk *chunk = data;
+
+    if(!g_atomic_int_get(&job->cancelled)) {
+        job->scanChunk(job, chunk);
+    }
+
+    if(job->mergeChunk) {
+        // Whoever fills the gap merges everything behind it, so the outcome doesn't depend on which worker finished first
+        g_mutex_lock(&job->mergeLock);
+        chunk->scanned = TRUE;
+        while(job->nextMerge < job->numChunks && job->chunks[job->nextMerge].scanned) {
+            job->mergeChunk(job, &job->chunks[job->nextMerge]);
+            job->nextMerge++;
+        }
+        g_mutex_unlock(&job->mergeLock);
+    }
+
+    if(g_atomic_int_add(&job->chunksDone, 1) + 1 == job->numChunks) {
+        g_atomic_int_set(&job->finishQueued, 1);
+        g_idle_add(scanJobFinished, job);
+    }
+}
+
+gboolean scanJobFinished(gpointer data) {
+    ScanJob *job = data;
+
+    if(!g_atomic_int_get(&job->cancelled)) {
+        GArray *results = g_array_new(FALSE, FALSE, job->resultSize);
+
+        // Every task is done, this only reclaims the threads
+        g_thread_pool_free(job->pool, FALSE, TRUE);
+        job->pool = NULL;
+
+        // In the order of the chunks that own them, only sorted overall if a result sorts by where its chunk found it
+        for(ulong i = 0; i < job->numChunks; i++) {
+            g_array_append_vals(results, job->chunks[i].results->data, job->chunks[i].results->len);
+        }
+
+        job->finished(job, results);
+    }
+
+    freeScanJob(job);
+
+    return G_SOURCE_REMOVE;
+}
+
+void freeScanJob(ScanJob *job) {
+    for(ulong i = 0; i < job->numChunks; i++) {
+        g_array_free(job->chunks[i].results, TRUE);
+    }
+
+    g_mutex_clear(&job->mergeLock);
+    free(job->chunks);
+    free(job->data);
+    free(job);
+}
+
+ScanJob *startScanJob(ulong chunkSize, guint resultSize, void (*scanChunk)(ScanJob *, ScanChunk *), void (*mergeChunk)(ScanJob *, ScanChunk *), void (*finished)(ScanJob *, GArray *), gpointer data) {
+    ScanJob *job = calloc(1, sizeof(ScanJob));
+
+    job->fileLength = state.fileLength;
+    job->numChunks = MAX(1, (job->fileLength + chunkSize - 1) / chunkSize);
+    job->chunks = calloc(job->numChunks, sizeof(ScanChunk));
+    job->resultSize = resultSize;
+    job->scanChunk = scanChunk;
+    job->mergeChunk = mergeChunk;
+    job->finished = finished;
+    job->data = data;
+    g_mutex_init(&job->mergeLock);
+
+    for(ulong i = 0; i < job->numChunks; i++) {
+        job->chunks[i].start = i * chunkSize;
+        job->chunks[i].end = MIN((i + 1) * chunkSize, job->fileLength);
+        job->chunks[i].results = g_array_new(FALSE, FALSE, resultSize);
+    }
+
+    job->pool = g_thread_pool_new(scanJobWorker, job, g_get_num_processors(), FALSE, NULL);
+
+    for(ulong i = 0; i < job->numChunks; i++) {
+        g_thread_pool_push(job->pool, &job->chunks[i], NULL);
+    }
+
+    return job;
+}
+
+void cancelScanJob(ScanJob *job) {
+    g_atomic_int_set(&job->cancelled, 1);
+
+    // Drops the queued chunks and waits for the ones being scanned
+    g_thread_pool_free(job->pool, TRUE, TRUE);
+    job->pool = NULL;
+
+    if(!g_atomic_int_get(&job->finishQueued)) {
+        freeScanJob(job);
+    }
+    // Otherwise scanJobFinished is already queued and frees it
+}
+
+double scanJobProgress(ScanJob *job) {
+    return (double) g_atomic_int_get(&job->chunksDone) / job->numChunks;
+}
+
+ulong skipNonText(const byte *data, ulong length) {
+    ulong i = 0;
+
+    // Bytes that can't be part of any string (controls other than tab) are the bulk of most binaries
+#ifdef __SSE2__
+    const __m128i controlMax = _mm_set1_epi8(0x1F);
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i del = _mm_set1_epi8(0x7F);
+
+    for(; i + 16 <= length; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *) (data + i));
+        __m128i isControl = _mm_cmpeq_epi8(_mm_min_epu8(bytes, controlMax), bytes);
+        __m128i nonText = _mm_or_si128(_mm_andnot_si128(_mm_cmpeq_epi8(bytes, tab), isControl), _mm_cmpeq_epi8(bytes, del));
+        uint mask = _mm_movemask_epi8(nonText);
+
+        if(mask != 0xFFFF) {
+            return i + __builtin_ctz(~mask);
+        }
+    }
+#endif
+
+    for(; i < length; i++) {
+        if(IS_TEXT_ASCII(data[i]) || data[i] >= 0x80) {
+            break;
+        }
+    }
+
+    return i;
+}
+
+uint utf8TextLength(const byte *data, ulong available) {
+    uint length = 0;
+    uint codepoint = 0;
+
+    if(data[0] < 0x80) {
+        return IS_TEXT_ASCII(data[0]) ? 1 : 0;
+    }
+    else if(IN_RANGE(data[0], 0xC2, 0xDF)) {
+        length = 2;
+        codepoint = data[0] & 0x1F;
+    }
+    else if(IN_RANGE(data[0], 0xE0, 0xEF)) {
+        length = 3;
+        codepoint = data[0] & 0x0F;
+    }
+    else if(IN_RANGE(data[0], 0xF0, 0xF4)) {
+        length = 4;
+        codepoint = data[0] & 0x07;
+    }
+    else {
+        return 0;
+    }
+
+    if(available < length) {
+        return 0;
+    }
+
+    for(uint i = 1; i < length; i++) {
+        if((data[i] & 0xC0) != 0x80) {
+            return 0;
+        }
+
+        codepoint = (codepoint << 6) | (data[i] & 0x3F);
+    }
+
+    // Overlongs, surrogates, out of range and C1 controls
+    if((length == 3 && codepoint < 0x800) || (length == 4 && (codepoint < 0x10000 || codepoint > 0x10FFFF)) || IN_RANGE(codepoint, 0xD800, 0xDFFF) || codepoint < 0xA0) {
+        return 0;
+    }
+
+    return length;
+}
+
+uint textLength8(const byte *data, ulong available, bool utf8) {
+    // Without UTF-8 a multibyte character ends the run instead of turning all of it into a UTF-8 string
+    if(!utf8) {
+        return IS_TEXT_ASCII(data[0]) ? 1 : 0;
+    }
+
+    return utf8TextLength(data, available);
+}
+
+bool utf16IsText(const byte *data, bool bigEndian) {
+    byte high = bigEndian ? data[0] : data[1];
+    byte low = bigEndian ? data[1] : data[0];
+
+    // Latin-1 only, accepting all of the BMP turns random data into strings
+    return high == 0 && (IS_TEXT_ASCII(low) || low >= 0xA0);
+}
+
+void addStringHit(GArray *hits, ulong offset, ulong length, uint encoding) {
+    StringHit hit = {offset, MIN(length, G_MAXUINT), encoding};
+
+    g_array_append_val(hits, hit);
+}
+
+void scanStrings8(ScanChunk *chunk, StringsOptions *options, ulong fileEnd) {
+    const byte *buffer = state.fileBuffer;
+    ulong position = chunk->start;
+    uint length = 0;
+
+    // A run that crosses into this chunk belongs to the chunk it started in. UTF-8 is self synchronizing
+    // so backing up to the lead byte of the previous character says whether one is in progress.
+    if(position > 0) {
+        ulong lead = position - 1;
+
+        for(int i = 0; i < 3 && lead > 0 && (buffer[lead] & 0xC0) == 0x80; i++) {
+            lead--;
+        }
+
+        length = textLength8(buffer + lead, fileEnd - lead, options->utf8);
+        if(length && lead + length >= position) {
+            position = lead + length;
+
+            while(position < fileEnd && (length = textLength8(buffer + position, fileEnd - position, options->utf8))) {
+                position += length;
+            }
+        }
+    }
+
+    while(position < chunk->end) {
+        position += skipNonText(buffer + position, chunk->end - position);
+        if(position >= chunk->end) {
+            break;
+        }
+
+        ulong runStart = position;
+        ulong chars = 0;
+        bool multibyte = FALSE;
+
+        // Runs that start in this chunk are followed past its end
+        while(position < fileEnd && (length = textLength8(buffer + position, fileEnd - position, options->utf8))) {
+            multibyte |= length > 1;
+            position += length;
+            chars++;
+        }
+
+        if(chars == 0) {
+            position++;
+            continue;
+        }
+
+        if(chars >= options->minLength && (multibyte ? options->utf8 : options->ascii)) {
+            addStringHit(chunk->results, runStart, position - runStart, multibyte ? STRINGS_UTF8 : STRINGS_ASCII);
+        }
+    }
+}
+
+void scanStrings16(ScanChunk *chunk, StringsOptions *options, bool bigEndian, ulong fileEnd) {
+    const byte *buffer = state.fileBuffer;
+
+    // Chunks start on even offsets so each parity is scanned separately to catch unaligned strings
+    for(int parity = 0; parity < 2; parity++) {
+        ulong position = chunk->start + parity;
+
+        if(chunk->start > 0) {
+            ulong previous = chunk->start - 2 + parity;
+
+            if(previous + 2 <= fileEnd && utf16IsText(buffer + previous, bigEndian)) {
+                position = previous + 2;
+
+                while(position + 2 <= fileEnd && utf16IsText(buffer + position, bigEndian)) {
+                    position += 2;
+                }
+            }
+        }
+
+        while(position < chunk->end && position + 2 <= fileEnd) {
+            ulong runStart = position;
+            ulong chars = 0;
+
+            while(position + 2 <= fileEnd && utf16IsText(buffer + position, bigEndian)) {
+                position += 2;
+                chars++;
+            }
+
+            if(chars == 0) {
+                position += 2;
+                continue;
+            }
+
+            if(chars >= options->minLength) {
+                addStringHit(chunk->results, runStart, position - runStart, bigEndian ? STRINGS_UTF16BE : STRINGS_UTF16LE);
+            }
+        }
+    }
+}
+
+gint compareStringHits(gconstpointer a, gconstpointer b) {
+    const StringHit *first = a;
+    const StringHit *second = b;
+
+    if(first->offset != second->offset) {
+        return first->offset < second->offset ? -1 : 1;
+    }
+
+    return (int) first->encoding - (int) second->encoding;
+}
+
+void scanStringsChunk(ScanJob *job, ScanChunk *chunk) {
+    StringsOptions *options = job->data;
+
+    if(options->ascii || options->utf8) {
+        scanStrings8(chunk, options, job->fileLength);
+    }
+
+    if(options->utf16le) {
+        scanStrings16(chunk, options, FALSE, job->fileLength);
+    }
+
+    if(options->utf16be) {
+        scanStrings16(chunk, options, TRUE, job->fileLength);
+    }
+
+    g_array_sort(chunk->results, compareStringHits);
+}
+
+void stringsScanFinished(ScanJob *job, GArray *results) {
+    char status[64] = {0};
+
+    state.stringsJob = NULL;
+    setStringsResults(results);
+
+    snprintf(status, 64, "%u strings", results->len);
+    gtk_label_set_text(GTK_LABEL(state.stringsStatus), status);
+    gtk_widget_set_sensitive(state.stringsScanButton, TRUE);
+}
+
+gboolean stringsUpdateProgress(gpointer data) {
+    char status[64] = {0};
+
+    if(!state.stringsJob) {
+        state.stringsTimerId = 0;
+        return G_SOURCE_REMOVE;
+    }
+
+    snprintf(status, 64, "Scanning... %d%%", (int) (scanJobProgress(state.stringsJob) * 100));
+    gtk_label_set_text(GTK_LABEL(state.stringsStatus), status);
+
+    return G_SOURCE_CONTINUE;
+}
+
+void setStringsResults(GArray *results) {
+    if(state.stringsResults) {
+        g_array_free(state.stringsResults, TRUE);
+    }
+
+    state.stringsResults = results;
+    state.stringsSelectedRow = STRINGS_NO_SELECTION;
+
+    if(state.stringsAdj) {
+        gtk_adjustment_set_value(state.stringsAdj, 0);
+        onStringsListSize(state.stringsList, NULL);
+        gtk_widget_queue_draw(state.stringsList);
+    }
+}
+
+void stopStringsScan() {
+    if(state.stringsJob) {
+        cancelScanJob(state.stringsJob);
+        state.stringsJob = NULL;
+    }
+
+    if(state.stringsTimerId) {
+        g_source_remove(state.stringsTimerId);
+        state.stringsTimerId = 0;
+    }
+
+    if(state.stringsScanButton) {
+        gtk_widget_set_sensitive(state.stringsScanButton, TRUE);
+    }
+}
+
+void stringsScanAction(GtkWidget *button) {
+    if(!state.file || state.fileLength == 0) {
+        return;
+    }
+
+    stopStringsScan();
+    setStringsResults(NULL);
+
+    StringsOptions *options = calloc(1, sizeof(StringsOptions));
+    options->minLength = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(state.stringsMinLength));
+    options->ascii = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(state.stringsAsciiCheck));
+    options->utf8 = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(state.stringsUtf8Check));
+    options->utf16le = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(state.stringsUtf16leCheck));
+    options->utf16be = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(state.stringsUtf16beCheck));
+
+    gtk_widget_set_sensitive(state.stringsScanButton, FALSE);
+    gtk_label_set_text(GTK_LABEL(state.stringsStatus), "Scanning...");
+
+    state.stringsJob = startScanJob(SCAN_CHUNK_SIZE, sizeof(StringHit), scanStringsChunk, NULL, stringsScanFinished, options);
+    state.stringsTimerId = g_timeout_add(EXPORT_PROGRESS_INTERVAL_MS, stringsUpdateProgress, NULL);
+}
+
+void jumpToRange(ulong offset, ulong length) {
+    if(!state.file || length == 0 || offset + length > state.fileLength) {
+        return;
+    }
+
+    state.selectionAnchor = offset;
+    state.selectionCursor = offset + length - 1;
+    state.hasSelection = TRUE;
+
+    // Same as goto, the line lands at the top of the view
+    gtk_adjustment_set_value(state.scrollAdj, clampScrollValue(offset / LINE_LENGTH));
+    gtk_widget_queue_draw(state.viewWidgetsBox);
+}
+
+uint formatStringHit(StringHit *hit, char *dest, uint destLength) {
+    const byte *data = state.fileBuffer + hit->offset;
+    uint written = 0;
+    uint step = (hit->encoding == STRINGS_UTF16LE || hit->encoding == STRINGS_UTF16BE) ? 2 : 1;
+
+    // Only as much as fits on a row is ever decoded, nothing is kept per hit besides the offset
+    for(uint i = 0; i < hit->length && written + 4 < destLength; i += step) {
+        byte current = (hit->encoding == STRINGS_UTF16BE) ? data[i + 1] : data[i];
+
+        if(current == '\t') {
+            dest[written++] = ' ';
+        }
+        else if(step == 2 && current >= 0x80) {
+            // Latin-1 to UTF-8
+            dest[written++] = 0xC0 | (current >> 6);
+            dest[written++] = 0x80 | (current & 0x3F);
+        }
+        else {
+            dest[written++] = current;
+        }
+    }
+
+    // Don't cut a UTF-8 sequence in half
+    while(written > 0 && step == 1 && (byte) dest[written - 1] >= 0x80 && !g_utf8_validate(dest, written, NULL)) {
+        written--;
+    }
+
+    dest[written] = '\0';
+
+    return written;
+}
+
+gboolean renderStringsList(GtkWidget *widget, cairo_t *cr) {
+    static const char *encodingNames[] = {"ascii", "utf-8", "utf-16le", "utf-16be"};
+
+    GtkStyleContext *styleContext = gtk_widget_get_style_context(widget);
+    GtkStateFlags widgetState = gtk_style_context_get_state(styleContext);
+
+    PangoContext *pangoContext = gtk_widget_get_pango_context(widget);
+    PangoLayout *pangoLayout = pango_layout_new(pangoContext);
+
+    GdkRGBA fgColor = {0};
+    GdkRGBA selectedColor = {0.21, 0.52, 0.89, 0.5};
+
+    char text[STRINGS_DISPLAY_LENGTH] = {0};
+    char row[STRINGS_DISPLAY_LENGTH + 32] = {0};
+
+    gtk_style_context_get_color(styleContext, widgetState, &fgColor);
+    gtk_style_context_lookup_color(styleContext, "theme_selected_bg_color", &selectedColor);
+
+    uint width = gtk_widget_get_allocated_width(widget);
+    uint height = gtk_widget_get_allocated_height(widget);
+
+    gtk_render_background(styleContext, cr, 0, 0, width, height);
+
+    if(!state.stringsResults || !state.file) {
+        g_object_unref(G_OBJECT(pangoLayout));
+        return FALSE;
+    }
+
+    pango_layout_set_font_description(pangoLayout, state.fontDesc);
+
+    // Only the rows on screen are formatted so the list costs the same with ten hits or ten million
+    uint first = gtk_adjustment_get_value(state.stringsAdj);
+    uint rows = height / state.fontHeight + 1;
+    for(uint i = 0; i < rows && first + i < state.stringsResults->len; i++) {
+        StringHit *hit = &g_array_index(state.stringsResults, StringHit, first + i);
+
+        if(first + i == state.stringsSelectedRow) {
+            gdk_cairo_set_source_rgba(cr, &selectedColor);
+            cairo_rectangle(cr, 0, i * state.fontHeight, width, state.fontHeight);
+            cairo_fill(cr);
+        }
+
+        formatStringHit(hit, text, STRINGS_DISPLAY_LENGTH);
+        snprintf(row, sizeof(row), "%08lX  %-8s  %s", hit->offset, encodingNames[hit->encoding], text);
+        pango_layout_set_text(pangoLayout, row, -1);
+
+        gdk_cairo_set_source_rgba(cr, &fgColor);
+        cairo_move_to(cr, TEXT_MARGIN_PX, i * state.fontHeight);
+        pango_cairo_show_layout(cr, pangoLayout);
+    }
+
+    g_object_unref(G_OBJECT(pangoLayout));
+
+    return FALSE;
+}
+
+void onStringsListSize(GtkWidget *widget, GdkRectangle *newRectangle) {
+    uint rows = 0;
+    uint pageRows = 1;
+
+    if(state.stringsResults) {
+        rows = state.stringsResults->len;
+    }
+
+    if(state.fontHeight != 0) {
+        pageRows = MAX(1, gtk_widget_get_allocated_height(widget) / state.fontHeight);
+    }
+
+    gtk_adjustment_configure(state.stringsAdj, gtk_adjustment_get_value(state.stringsAdj), 0, rows, 1, pageRows, pageRows);
+}
+
+bool onStringsListPress(GtkWidget *widget, GdkEventButton *event) {
+    if(!state.stringsResults || event->button != GDK_BUTTON_PRIMARY) {
+        return FALSE;
+    }
+
+    uint row = gtk_adjustment_get_value(state.stringsAdj) + event->y / state.fontHeight;
+    if(row >= state.stringsResults->len) {
+        return FALSE;
+    }
+
+    StringHit *hit = &g_array_index(state.stringsResults, StringHit, row);
+
+    state.stringsSelectedRow = row;
+    gtk_widget_queue_draw(state.stringsList);
+
+    jumpToRange(hit->offset, hit->length);
+
+    return TRUE;
+}
+
+bool onStringsListScroll(GtkWidget *widget, GdkEvent *event) {
+    gtk_widget_event(state.stringsScrollBar, event);
+
+    return TRUE;
+}
+
+void onStringsAdjValueChanged(GtkAdjustment *adj) {
+    gtk_widget_queue_draw(state.stringsList);
+}
+
+void buildStringsWindow() {
+    GtkWidget *vbox = NULL;
+    GtkWidget *optionsBox = NULL;
+    GtkWidget *listBox = NULL;
+
+    state.stringsWindow = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+    gtk_window_set_title(GTK_WINDOW(state.stringsWindow), "JAFHE - Strings");
+    gtk_window_set_default_size(GTK_WINDOW(state.stringsWindow), 600, 400);
+    gtk_window_set_transient_for(GTK_WINDOW(state.stringsWindow), GTK_WINDOW(state.window));
+    g_signal_connect(G_OBJECT(state.stringsWindow), "delete-event", G_CALLBACK(gtk_widget_hide_on_delete), NULL);
+
+    vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, BOX_SPACING_PX);
+    gtk_container_add(GTK_CONTAINER(state.stringsWindow), vbox);
+
+    optionsBox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, BOX_SPACING_PX);
+
+    state.stringsMinLength = gtk_spin_button_new_with_range(1, 1024, 1);
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(state.stringsMinLength), STRINGS_DEFAULT_MIN_LENGTH);
+
+    state.stringsAsciiCheck = gtk_check_button_new_with_label("ASCII");
+    state.stringsUtf8Check = gtk_check_button_new_with_label("UTF-8");
+    state.stringsUtf16leCheck = gtk_check_button_new_with_label("UTF-16LE (Latin-1)");
+    state.stringsUtf16beCheck = gtk_check_button_new_with_label("UTF-16BE (Latin-1)");
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(state.stringsAsciiCheck), TRUE);
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(state.stringsUtf8Check), TRUE);
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(state.stringsUtf16leCheck), TRUE);
+
+    state.stringsScanButton = gtk_button_new_with_label("Scan");
+    g_signal_connect(state.stringsScanButton, "clicked", G_CALLBACK(stringsScanAction), NULL);
+
+    state.stringsStatus = gtk_label_new("");
+
+    gtk_box_pack_start(GTK_BOX(optionsBox), gtk_label_new("Min Length"), FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(optionsBox), state.stringsMinLength, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(optionsBox), state.stringsAsciiCheck, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(optionsBox), state.stringsUtf8Check, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(optionsBox), state.stringsUtf16leCheck, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(optionsBox), state.stringsUtf16beCheck, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(optionsBox), state.stringsScanButton, FALSE, FALSE, 0);
+    gtk_box_pack_end(GTK_BOX(optionsBox), state.stringsStatus, FALSE, FALSE, 0);
+
+    listBox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
+
+    state.stringsList = gtk_drawing_area_new();
+    gtk_style_context_add_class(gtk_widget_get_style_context(state.stringsList), GTK_STYLE_CLASS_VIEW);
+    gtk_widget_set_events(state.stringsList, GDK_SCROLL_MASK | GDK_BUTTON_PRESS_MASK);
+    g_signal_connect(state.stringsList, "draw", G_CALLBACK(renderStringsList), NULL);
+    g_signal_connect(state.stringsList, "size-allocate", G_CALLBACK(onStringsListSize), NULL);
+    g_signal_connect(state.stringsList, "button-press-event", G_CALLBACK(onStringsListPress), NULL);
+    g_signal_connect(state.stringsList, "scroll-event", G_CALLBACK(onStringsListScroll), NULL);
+
+    state.stringsAdj = gtk_adjustment_new(0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+    g_signal_connect(state.stringsAdj, "value-changed", G_CALLBACK(onStringsAdjValueChanged), NULL);
+    state.stringsScrollBar = gtk_scrollbar_new(GTK_ORIENTATION_VERTICAL, state.stringsAdj);
+
+    gtk_box_pack_start(GTK_BOX(listBox), state.stringsList, TRUE, TRUE, 0);
+    gtk_box_pack_end(GTK_BOX(listBox), state.stringsScrollBar, FALSE, FALSE, 0);
+
+    gtk_box_pack_start(GTK_BOX(vbox), optionsBox, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(vbox), listBox, TRUE, TRUE, 0);
+}
+
+void stringsMenuAction(GtkMenuItem *menuItem) {
+    if(!state.stringsWindow) {
+        buildStringsWindow();
+    }
+
+    gtk_widget_show_all(state.stringsWindow);
+    gtk_window_present(GTK_WINDOW(state.stringsWindow));
+}
+
+static const Signature signatures[] = {
+    // Name                  Magic                                     Offset  Header  Validator
+    {"ZIP archive",          MAGIC("PK\3\4"),                          0,      30,     validateZip},
+    {"gzip",                 MAGIC("\x1F\x8B\x08"),                     0,      10,     validateGzip},
+    {"bzip2",                MAGIC("BZh"),                             0,      10,     validateBzip2},
+    {"xz",                   MAGIC("\xFD" "7zXZ\0"),                    0,      12,     validateXz},
+    {"7-Zip archive",        MAGIC("7z\xBC\xAF\x27\x1C"),                0,      8,      validate7z},
+    {"Zstandard",            MAGIC("\x28\xB5\x2F\xFD"),                 0,      5,      validateZstd},
+    {"LZ4 frame",            MAGIC("\x04\x22\x4D\x18"),                 0,      7,      validateLz4},
+    {"lzop",                 MAGIC("\x89LZO\0\r\n\x1A\n"),              0,      9,      NULL},
+    {"RAR archive",          MAGIC("Rar!\x1A\x07\x00"),                  0,      7,      NULL},
+    {"RAR5 archive",         MAGIC("Rar!\x1A\x07\x01\x00"),              0,      8,      NULL},
+    {"POSIX tar archive",    MAGIC("ustar"),                           257,    512,    validateTar},
+    {"cpio archive",         MAGIC("070701"),                          0,      110,    validateCpio},
+    {"cpio archive (CRC)",   MAGIC("070702"),                          0,      110,    validateCpio},
+    {"Cabinet archive",      MAGIC("MSCF"),                            0,      36,     validateCab},
+    {"ar archive",           MAGIC("!<arch>\n"),                       0,      8,      NULL},
+    {"PNG image",            MAGIC("\x89PNG\r\n\x1A\n"),                0,      16,     validatePng},
+    {"JPEG image",           MAGIC("\xFF\xD8\xFF"),                     0,      4,      validateJpeg},
+    {"GIF image",            MAGIC("GIF87a"),                          0,      10,     validateGif},
+    {"GIF image",            MAGIC("GIF89a"),                          0,      10,     validateGif},
+    {"BMP image",            MAGIC("BM"),                              0,      18,     validateBmp},
+    {"TIFF image",           MAGIC("II*\0"),                           0,      8,      validateTiff},
+    {"TIFF image",           MAGIC("MM\0*"),                           0,      8,      validateTiff},
+    {"RIFF container",       MAGIC("RIFF"),                            0,      12,     validateRiff},
+    {"ELF executable",       MAGIC("\x7F" "ELF"),                      0,      7,      validateElf},
+    {"PE executable",        MAGIC("MZ"),                              0,      64,     validatePe},
+    {"Mach-O executable",    MAGIC("\xFE\xED\xFA\xCE"),                 0,      20,     validateMachO},
+    {"Mach-O executable",    MAGIC("\xFE\xED\xFA\xCF"),                 0,      20,     validateMachO},
+    {"Mach-O executable",    MAGIC("\xCE\xFA\xED\xFE"),                 0,      20,     validateMachO},
+    {"Mach-O executable",    MAGIC("\xCF\xFA\xED\xFE"),                 0,      20,     validateMachO},
+    {"Java class",           MAGIC("\xCA\xFE\xBA\xBE"),                 0,      8,      validateJavaClass},
+    {"Dalvik executable",    MAGIC("dex\n"),                           0,      8,      validateDex},
+    {"SquashFS filesystem",  MAGIC("hsqs"),                            0,      30,     validateSquashfs},
+    {"SquashFS filesystem",  MAGIC("sqsh"),                            0,      30,     validateSquashfs},
+    {"CramFS filesystem",    MAGIC("\x45\x3D\xCD\x28"),                 0,      32,     validateCramfs},
+    {"ext2/3/4 filesystem",  MAGIC("\x53\xEF"),                         0x438,  0x450,  validateExt},
+    {"ISO 9660 filesystem",  MAGIC("CD001"),                           0x8001, 0x8007, validateIso9660},
+    {"FAT filesystem",       MAGIC("FAT12   "),                        54,     512,    validateFat},
+    {"FAT filesystem",       MAGIC("FAT16   "),                        54,     512,    validateFat},
+    {"FAT filesystem",       MAGIC("FAT32   "),                        82,     512,    validateFat},
+    {"UBI image",            MAGIC("UBI#"),                            0,      5,      validateUbi},
+    {"U-Boot image",         MAGIC("\x27\x05\x19\x56"),                 0,      64,     validateUImage},
+    {"Device tree blob",     MAGIC("\xD0\x0D\xFE\xED"),                 0,      24,     validateDtb},
+    {"LUKS volume",          MAGIC("LUKS\xBA\xBE"),                     0,      8,      validateLuks},
+    {"PDF document",         MAGIC("%PDF-"),                           0,      8,      validatePdf},
+    {"SQLite database",      MAGIC("SQLite format 3\0"),               0,      18,     validateSqlite},
+    {"OLE compound file",    MAGIC("\xD0\xCF\x11\xE0\xA1\xB1\x1A\xE1"), 0,      30,     validateOle},
+    {"ISO media (MP4)",      MAGIC("ftyp"),                            4,      12,     validateMp4},
+    {"Ogg stream",           MAGIC("OggS"),                            0,      6,      validateOgg},
+    {"FLAC audio",           MAGIC("fLaC"),                            0,      8,      validateFlac},
+    {"ID3 tag",              MAGIC("ID3"),                             0,      10,     validateId3},
+    {"Matroska/WebM",        MAGIC("\x1A\x45\xDF\xA3"),                 0,      4,      NULL},
+    {"PEM block",            MAGIC("-----BEGIN "),                     0,      12,     validatePem},
+};
+
+uint readLE16(const byte *data) {
+    return data[0] | (data[1] << 8);
+}
+
+uint readLE32(const byte *data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint) data[3] << 24);
+}
+
+uint readBE16(const byte *data) {
+    return (data[0] << 8) | data[1];
+}
+
+uint readBE32(const byte *data) {
+    return ((uint) data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+}
+
+uint computeCrc32(const byte *data, ulong length) {
+    uint crc = 0xFFFFFFFF;
+
+    // Only ever run over a few header bytes, not worth a table
+    for(ulong i = 0; i < length; i++) {
+        crc ^= data[i];
+
+        for(int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+
+    return ~crc;
+}
+
+bool validateZip(const byte *data, ulong available) {
+    uint method = readLE16(data + 8);
+    uint nameLength = readLE16(data + 26);
+
+    return data[4] <= 63 && (method <= 19 || method == 93 || method == 95 || method == 98 || method == 99) && IN_RANGE(nameLength, 1, 1024);
+}
+
+bool validateGzip(const byte *data, ulong available) {
+    return (data[3] & 0xE0) == 0 && (data[8] == 0 || data[8] == 2 || data[8] == 4) && (data[9] <= 13 || data[9] == 0xFF);
+}
+
+bool validateBzip2(const byte *data, ulong available) {
+    static const byte blockMagic[] = {0x31, 0x41, 0x59, 0x26, 0x53, 0x59};
+    static const byte endMagic[] = {0x17, 0x72, 0x45, 0x38, 0x50, 0x90};
+
+    return IN_RANGE(data[3], '1', '9') && (memcmp(data + 4, blockMagic, 6) == 0 || memcmp(data + 4, endMagic, 6) == 0);
+}
+
+bool validateXz(const byte *data, ulong available) {
+    return data[6] == 0 && data[7] <= 0x0F && computeCrc32(data + 6, 2) == readLE32(data + 8);
+}
+
+bool validate7z(const byte *data, ulong available) {
+    return data[6] == 0 && data[7] <= 4;
+}
+
+bool validateZstd(const byte *data, ulong available) {
+    return (data[4] & 0x08) == 0;
+}
+
+bool validateLz4(const byte *data, ulong available) {
+    return (data[4] >> 6) == 1 && (data[4] & 0x02) == 0 && (data[5] & 0x8F) == 0 && IN_RANGE(data[5] >> 4, 4, 7);
+}
+
+bool validateTar(const byte *data, ulong available) {
+    char field[9] = {0};
+    char *rest = NULL;
+    uint sum = 0;
+
+    // The checksum field counts as spaces
+    for(int i = 0; i < 512; i++) {
+        sum += IN_RANGE(i, 148, 155) ? ' ' : data[i];
+    }
+
+    memcpy(field, data + 148, 8);
+    ulong stored = strtoul(field, &rest, 8);
+
+    return rest != field && stored == sum;
+}
+
+bool validateCpio(const byte *data, ulong available) {
+    // Thirteen 8 digit hex fields follow the magic
+    for(int i = 6; i < 110; i++) {
+        if(!g_ascii_isxdigit(data[i])) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+bool validateCab(const byte *data, ulong available) {
+    return readLE32(data + 4) == 0 && data[24] == 3 && data[25] == 1;
+}
+
+bool validatePng(const byte *data, ulong available) {
+    return readBE32(data + 8) == 13 && memcmp(data + 12, "IHDR", 4) == 0;
+}
+
+bool validateJpeg(const byte *data, ulong available) {
+    return IN_RANGE(data[3], 0xE0, 0xEF) || data[3] == 0xDB || data[3] == 0xC0 || data[3] == 0xC2 || data[3] == 0xC4 || data[3] == 0xFE;
+}
+
+bool validateGif(const byte *data, ulong available) {
+    return readLE16(data + 6) != 0 && readLE16(data + 8) != 0;
+}
+
+bool validateBmp(const byte *data, ulong available) {
+    uint size = readLE32(data + 2);
+    uint pixels = readLE32(data + 10);
+    uint header = readLE32(data + 14);
+
+    return readLE32(data + 6) == 0 && size >= 26 && pixels < size && (header == 12 || header == 40 || header == 52 || header == 56 || header == 64 || header == 108 || header == 124);
+}
+
+bool validateTiff(const byte *data, ulong available) {
+    uint firstIfd = data[0] == 'I' ? readLE32(data + 4) : readBE32(data + 4);
+
+    return firstIfd >= 8 && firstIfd < available;
+}
+
+bool validateRiff(const byte *data, ulong available) {
+    for(int i = 8; i < 12; i++) {
+        if(!IN_RANGE(data[i], 0x20, 0x7E)) {
+            return FALSE;
+        }
+    }
+
+    return readLE32(data + 4) >= 4;
+}
+
+bool validateElf(const byte *data, ulong available) {
+    return (data[4] == 1 || data[4] == 2) && (data[5] == 1 || data[5] == 2) && data[6] == 1;
+}
+
+bool validatePe(const byte *data, ulong available) {
+    uint peOffset = readLE32(data + 0x3C);
+
+    return peOffset >= 0x40 && peOffset <= 0x10000 && peOffset + 4 <= available && memcmp(data + peOffset, "PE\0\0", 4) == 0;
+}
+
+bool validateMachO(const byte *data, ulong available) {
+    bool littleEndian = data[0] != 0xFE;
+    uint fileType = littleEndian ? readLE32(data + 12) : readBE32(data + 12);
+    uint numCommands = littleEndian ? readLE32(data + 16) : readBE32(data + 16);
+
+    return IN_RANGE(fileType, 1, 12) && IN_RANGE(numCommands, 1, 4096);
+}
+
+bool validateJavaClass(const byte *data, ulong available) {
+    // Fat Mach-O binaries share the magic, their next field is a small architecture count
+    return IN_RANGE(readBE16(data + 6), 45, 80);
+}
+
+bool validateDex(const byte *data, ulong available) {
+    return g_ascii_isdigit(data[4]) && g_ascii_isdigit(data[5]) && g_ascii_isdigit(data[6]) && data[7] == 0;
+}
+
+bool validateSquashfs(const byte *data, ulong available) {
+    bool littleEndian = data[0] == 'h';
+    uint blockLog = littleEndian ? readLE16(data + 22) : readBE16(data + 22);
+    uint major = littleEndian ? readLE16(data + 28) : readBE16(data + 28);
+
+    return IN_RANGE(major, 2, 4) && IN_RANGE(blockLog, 12, 20);
+}
+
+bool validateCramfs(const byte *data, ulong available) {
+    return memcmp(data + 16, "Compressed ROMFS", 16) == 0;
+}
+
+bool validateExt(const byte *data, ulong available) {
+    return readLE32(data + 0x400) != 0 && readLE32(data + 0x418) <= 6 && readLE32(data + 0x44C) <= 1;
+}
+
+bool validateIso9660(const byte *data, ulong available) {
+    return (data[0x8000] <= 3 || data[0x8000] == 0xFF) && data[0x8006] == 1;
+}
+
+bool validateFat(const byte *data, ulong available) {
+    uint sectorSize = readLE16(data + 11);
+
+    return (sectorSize == 512 || sectorSize == 1024 || sectorSize == 2048 || sectorSize == 4096) && data[13] != 0 && data[510] == 0x55 && data[511] == 0xAA;
+}
+
+bool validateUbi(const byte *data, ulong available) {
+    return data[4] == 1;
+}
+
+bool validateUImage(const byte *data, ulong available) {
+    byte header[64] = {0};
+
+    // The header CRC is computed with its own field zeroed
+    memcpy(header, data, 64);
+    memset(header + 4, 0, 4);
+
+    return computeCrc32(header, 64) == readBE32(data + 4);
+}
+
+bool validateDtb(const byte *data, ulong available) {
+    uint totalSize = readBE32(data + 4);
+    uint structOffset = readBE32(data + 8);
+    uint version = readBE32(data + 20);
+
+    return totalSize >= 40 && structOffset < totalSize && IN_RANGE(version, 1, 17);
+}
+
+bool validateLuks(const byte *data, ulong available) {
+    uint version = readBE16(data + 6);
+
+    return version == 1 || version == 2;
+}
+
+bool validatePdf(const byte *data, ulong available) {
+    return g_ascii_isdigit(data[5]) && data[6] == '.' && g_ascii_isdigit(data[7]);
+}
+
+bool validateSqlite(const byte *data, ulong available) {
+    uint pageSize = readBE16(data + 16);
+
+    // 1 means 65536
+    return pageSize == 1 || (pageSize >= 512 && (pageSize & (pageSize - 1)) == 0);
+}
+
+bool validateOle(const byte *data, ulong available) {
+    return data[28] == 0xFE && data[29] == 0xFF;
+}
+
+bool validateMp4(const byte *data, ulong available) {
+    uint boxSize = readBE32(data);
+
+    for(int i = 8; i < 12; i++) {
+        if(!IN_RANGE(data[i], 0x20, 0x7E)) {
+            return FALSE;
+        }
+    }
+
+    return IN_RANGE(boxSize, 16, 256);
+}
+
+bool validateOgg(const byte *data, ulong available) {
+    return data[4] == 0 && (data[5] & 0xF8) == 0;
+}
+
+bool validateFlac(const byte *data, ulong available) {
+    return (data[4] & 0x7F) == 0 && data[5] == 0 && data[6] == 0 && data[7] == 34;
+}
+
+bool validateId3(const byte *data, ulong available) {
+    return IN_RANGE(data[3], 2, 4) && (data[5] & 0x0F) == 0 && data[6] < 0x80 && data[7] < 0x80 && data[8] < 0x80 && data[9] < 0x80;
+}
+
+bool validatePem(const byte *data, ulong available) {
+    return IN_RANGE(data[11], 'A', 'Z');
+}
+
+void buildSignatureMatcher() {
+    SignatureMatcher *matcher = calloc(1, sizeof(SignatureMatcher));
+    uint capacity = 1;
+
+    for(uint i = 0; i < G_N_ELEMENTS(signatures); i++) {
+        capacity += signatures[i].magicLength;
+        matcher->maxLength = MAX(matcher->maxLength, signatures[i].magicLength);
+    }
+
+    // Dense 256 way transitions, a few hundred KB for the whole table and one lookup per byte when scanning
+    matcher->next = calloc((ulong) capacity * 256, sizeof(uint));
+    matcher->output = malloc(capacity * sizeof(int));
+    matcher->outputLink = calloc(capacity, sizeof(uint));
+    matcher->sameMagic = malloc(G_N_ELEMENTS(signatures) * sizeof(int));
+    matcher->numStates = 1;
+
+    uint *fail = calloc(capacity, sizeof(uint));
+    uint *queue = malloc(capacity * sizeof(uint));
+
+    memset(matcher->output, -1, capacity * sizeof(int));
+
+    // Trie of every magic, state 0 is the root so 0 doubles as "no child" while building
+    for(uint i = 0; i < G_N_ELEMENTS(signatures); i++) {
+        const byte *magic = (const byte *) signatures[i].magic;
+        uint current = 0;
+
+        for(uint j = 0; j < signatures[i].magicLength; j++) {
+            uint *child = &matcher->next[current * 256 + magic[j]];
+
+            if(!*child) {
+                *child = matcher->numStates++;
+            }
+            current = *child;
+        }
+
+        matcher->sameMagic[i] = matcher->output[current];
+        matcher->output[current] = i;
+    }
+
+    // Breadth first so every failure link points at a finished state, missing edges become failure transitions
+    uint head = 0;
+    uint tail = 0;
+    for(uint c = 0; c < 256; c++) {
+        uint child = matcher->next[c];
+
+        if(child) {
+            queue[tail++] = child;
+        }
+    }
+
+    while(head < tail) {
+        uint current = queue[head++];
+
+        for(uint c = 0; c < 256; c++) {
+            uint *child = &matcher->next[current * 256 + c];
+            uint fallback = matcher->next[fail[current] * 256 + c];
+
+            if(*child) {
+                fail[*child] = fallback;
+                matcher->outputLink[*child] = matcher->output[fallback] >= 0 ? fallback : matcher->outputLink[fallback];
+                queue[tail++] = *child;
+            }
+            else {
+                *child = fallback;
+            }
+        }
+    }
+
+    free(fail);
+    free(queue);
+
+    state.signatureMatcher = matcher;
+}
+
+void addSignatureHit(ScanJob *job, ScanChunk *chunk, ulong magicStart, int signature) {
+    const Signature *sig = &signatures[signature];
+
+    if(magicStart < sig->magicOffset) {
+        return;
+    }
+
+    ulong start = magicStart - sig->magicOffset;
+    ulong available = job->fileLength - start;
+
+    if(available < sig->headerLength) {
+        return;
+    }
+
+    if(sig->validate && !sig->validate(state.fileBuffer + start, available)) {
+        return;
+    }
+
+    SignatureHit hit = {start, signature};
+    g_array_append_val(chunk->results, hit);
+}
+
+gint compareSignatureHits(gconstpointer a, gconstpointer b) {
+    const SignatureHit *first = a;
+    const SignatureHit *second = b;
+
+    if(first->offset != second->offset) {
+        return first->offset < second->offset ? -1 : 1;
+    }
+
+    return (int) first->signature - (int) second->signature;
+}
+
+void scanSignaturesChunk(ScanJob *job, ScanChunk *chunk) {
+    SignatureMatcher *matcher = state.signatureMatcher;
+    const byte *buffer = state.fileBuffer;
+    uint current = 0;
+
+    // Matches are owned by the chunk their magic starts in, so start early enough to see one that ends here
+    // and run on until the longest magic starting before the end could have finished
+    ulong position = chunk->start - MIN(chunk->start, matcher->maxLength - 1);
+    ulong end = MIN(chunk->end + matcher->maxLength - 1, job->fileLength);
+
+    for(; position < end; position++) {
+        current = matcher->next[current * 256 + buffer[position]];
+
+        if(matcher->output[current] < 0 && !matcher->outputLink[current]) {
+            continue;
+        }
+
+        for(uint matched = current; matched; matched = matcher->outputLink[matched]) {
+            for(int signature = matcher->output[matched]; signature >= 0; signature = matcher->sameMagic[signature]) {
+                ulong magicStart = position + 1 - signatures[signature].magicLength;
+
+                if(magicStart >= chunk->start && magicStart < chunk->end) {
+                    addSignatureHit(job, chunk, magicStart, signature);
+                }
+            }
+        }
+    }
+}
+
+void signatureScanFinished(ScanJob *job, GArray *results) {
+    state.signatureJob = NULL;
+    stopSignatureScan();
+
+    if(state.signatureHits) {
+        g_array_free(state.signatureHits, TRUE);
+    }
+
+    // Hits are owned by the chunk holding their magic but sit at their header start, which for magics
+    // at a nonzero offset can be back in the previous chunk, so only the whole set can be ordered
+    g_array_sort(results, compareSignatureHits);
+    state.signatureHits = results;
+
+    gtk_widget_queue_draw(state.viewWidgetsBox);
+
+    if(results->len == 0) {
+        GtkWidget *infoDialog = gtk_message_dialog_new(GTK_WINDOW(state.window), GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT, GTK_MESSAGE_INFO, GTK_BUTTONS_CLOSE, "No known signatures found");
+        gtk_dialog_run(GTK_DIALOG(infoDialog));
+        gtk_widget_destroy(infoDialog);
+    }
+}
+
+gboolean signatureUpdateProgress(gpointer data) {
+    if(!state.signatureJob) {
+        return G_SOURCE_REMOVE;
+    }
+
+    gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(state.signatureProgressBar), scanJobProgress(state.signatureJob));
+
+    return G_SOURCE_CONTINUE;
+}
+
+void signatureDialogResponse(GtkWidget *dialog, gint response, gpointer data) {
+    stopSignatureScan();
+}
+
+void stopSignatureScan() {
+    if(state.signatureJob) {
+        cancelScanJob(state.signatureJob);
+        state.signatureJob = NULL;
+    }
+
+    if(state.signatureTimerId) {
+        g_source_remove(state.signatureTimerId);
+        state.signatureTimerId = 0;
+    }
+
+    if(state.signatureDialog) {
+        gtk_widget_destroy(state.signatureDialog);
+        state.signatureDialog = NULL;
+        state.signatureProgressBar = NULL;
+    }
+}
+
+void signaturesMenuAction(GtkMenuItem *menuItem) {
+    GtkWidget *dialogCBox = NULL;
+
+    if(!state.file || state.fileLength == 0 || state.signatureJob) {
+        return;
+    }
+
+    if(!state.signatureMatcher) {
+        buildSignatureMatcher();
+    }
+
+    state.signatureDialog = gtk_dialog_new_with_buttons("Scanning Signatures", GTK_WINDOW(state.window), GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT, "Cancel", GTK_RESPONSE_CANCEL, NULL);
+    g_signal_connect(state.signatureDialog, "response", G_CALLBACK(signatureDialogResponse), NULL);
+
+    state.signatureProgressBar = gtk_progress_bar_new();
+    dialogCBox = gtk_dialog_get_content_area(GTK_DIALOG(state.signatureDialog));
+    gtk_box_pack_start(GTK_BOX(dialogCBox), state.signatureProgressBar, FALSE, FALSE, 0);
+    gtk_widget_show_all(state.signatureDialog);
+
+    // All signatures in one pass, the automaton is shared read only between the workers
+    state.signatureJob = startScanJob(SCAN_CHUNK_SIZE, sizeof(SignatureHit), scanSignaturesChunk, NULL, signatureScanFinished, NULL);
+    state.signatureTimerId = g_timeout_add(EXPORT_PROGRESS_INTERVAL_MS, signatureUpdateProgress, NULL);
+}
+
+uint findSignatureHit(ulong offset) {
+    uint low = 0;
+    uint high = state.signatureHits ? state.signatureHits->len : 0;
+
+    // First hit at or after offset
+    while(low < high) {
+        uint middle = low + (high - low) / 2;
+
+        if(g_array_index(state.signatureHits, SignatureHit, middle).offset < offset) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+void jumpToSignature(int direction) {
+    ulong reference = (ulong) gtk_adjustment_get_value(state.scrollAdj) * LINE_LENGTH;
+    ulong start = 0;
+    ulong end = 0;
+    uint index = 0;
+
+    if(!state.signatureHits || state.signatureHits->len == 0) {
+        return;
+    }
+
+    // From the selected hit if there is one so repeated presses walk through them, otherwise from the top of the view
+    bool haveSelection = getSelection(&start, &end);
+    if(haveSelection) {
+        reference = start;
+    }
+
+    if(direction > 0) {
+        index = findSignatureHit(haveSelection ? reference + 1 : reference);
+    }
+    else {
+        index = findSignatureHit(reference);
+        if(index == 0) {
+            return;
+        }
+        index--;
+    }
+
+    if(index >= state.signatureHits->len) {
+        return;
+    }
+
+    jumpToRange(g_array_index(state.signatureHits, SignatureHit, index).offset, 1);
+}
+
+void nextSignatureMenuAction(GtkMenuItem *menuItem) {
+    jumpToSignature(1);
+}
+
+void previousSignatureMenuAction(GtkMenuItem *menuItem) {
+    jumpToSignature(-1);
+}
+
+bool onQuerySignatureTooltip(GtkWidget *widget, gint x, gint y, gboolean keyboardMode, GtkTooltip *tooltip) {
+    char text[96] = {0};
+
+    if(!state.file || !state.signatureHits || keyboardMode) {
+        return FALSE;
+    }
+
+    ulong offset = offsetAtPoint(widget, x, y);
+    uint index = findSignatureHit(offset);
+
+    if(index >= state.signatureHits->len || g_array_index(state.signatureHits, SignatureHit, index).offset != offset) {
+        return FALSE;
+    }
+
+    snprintf(text, 96, "%s at 0x%lX", signatures[g_array_index(state.signatureHits, SignatureHit, index).signature].name, offset);
+    gtk_tooltip_set_text(tooltip, text);
+
+    return TRUE;
+}
+
+void renderSignatureMarkers(cairo_t *cr, ulong lineOffset, int y, uint cellChars, uint gapChars) {
+    GdkRGBA markerColor = SIGNATURE_MARKER_COLOR;
+
+    if(!state.signatureHits) {
+        return;
+    }
+
+    cairo_save(cr);
+    gdk_cairo_set_source_rgba(cr, &markerColor);
+    cairo_set_line_width(cr, 1);
+
+    for(uint i = findSignatureHit(lineOffset); i < state.signatureHits->len; i++) {
+        ulong offset = g_array_index(state.signatureHits, SignatureHit, i).offset;
+
+        if(offset >= lineOffset + LINE_LENGTH) {
+            break;
+        }
+
+        // Outline the first byte of the embedded file, the half pixel keeps the line crisp
+        cairo_rectangle(cr, TEXT_MARGIN_PX + (offset - lineOffset) * cellChars * state.fontWidth + 0.5, y + 0.5, (cellChars - gapChars) * state.fontWidth - 1, state.fontHeight - 1);
+        cairo_stroke(cr);
+    }
+
+    cairo_restore(cr);
+}
+
+void buildGearTable() {
+    guint64 seed = 0x6A09E667F3BCC909;
+
+    // Any fixed random table works, it only has to be the same between the scan and later lookups (splitmix64)
+    for(int i = 0; i < 256; i++) {
+        guint64 value = (seed += 0x9E3779B97F4A7C15);
+
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EB;
+        state.gearTable[i] = value ^ (value >> 31);
+    }
+
+    state.gearTableValid = TRUE;
+}
+
+guint64 hashBlock(const byte *data, ulong length) {
+    guint64 hash = length * 0x9E3779B97F4A7C15;
+    ulong i = 0;
+
+    for(; i + 8 <= length; i += 8) {
+        guint64 word = 0;
+
+        memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCD;
+        hash ^= hash >> 32;
+    }
+
+    for(; i < length; i++) {
+        hash = (hash ^ data[i]) * 0x100000001B3;
+    }
+
+    hash ^= hash >> 29;
+    hash *= 0xC4CEB9FE1A85EC53;
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+ulong nextBlockLength(const byte *data, ulong available, int mode, uint blockSize) {
+    if(mode == DUPLICATE_FIXED || available <= blockSize / 4) {
+        return MIN(blockSize, available);
+    }
+
+    // Gear hash, each byte shifts the oldest one out after 64 steps so a cut only depends on the bytes just before it.
+    // Cuts follow the content, inserting a byte only moves the blocks around it instead of every block after it.
+    // The top bits are tested since the low ones only ever see the last few bytes
+    guint64 hash = 0;
+    guint64 mask = (guint64) (blockSize - 1) << (64 - g_bit_storage(blockSize - 1));
+    ulong minLength = blockSize / 4;
+    ulong maxLength = MIN((ulong) blockSize * 4, available);
+
+    for(ulong i = minLength; i < maxLength; i++) {
+        hash = (hash << 1) + state.gearTable[data[i]];
+
+        if((hash & mask) == 0) {
+            return i + 1;
+        }
+    }
+
+    return maxLength;
+}
+
+DuplicateIndex *newDuplicateIndex(ulong bytes) {
+    DuplicateIndex *index = calloc(1, sizeof(DuplicateIndex));
+    ulong numSlots = 1024;
+
+    // The largest slot table that still leaves room for half as many entries, then as many entries as fit
+    // beside it up to three quarters full. Both come out of the same budget.
+    while(numSlots < G_MAXINT / 2 && (numSlots * 2) * (sizeof(uint) + sizeof(BlockHash) / 2) <= bytes) {
+        numSlots <<= 1;
+    }
+
+    index->capacity = MIN(bytes > numSlots * sizeof(uint) ? (bytes - numSlots * sizeof(uint)) / sizeof(BlockHash) : 0, numSlots / 4 * 3);
+    index->capacity = MAX(index->capacity, numSlots / 2);
+
+    index->entries = malloc((ulong) index->capacity * sizeof(BlockHash));
+    index->slots = malloc((ulong) numSlots * sizeof(uint));
+    index->slotMask = numSlots - 1;
+
+    memset(index->slots, 0xFF, (ulong) numSlots * sizeof(uint));
+
+    return index;
+}
+
+void freeDuplicateIndex(DuplicateIndex *index) {
+    free(index->entries);
+    free(index->slots);
+    free(index);
+}
+
+void duplicateIndexInsertSlot(DuplicateIndex *index, uint entry) {
+    guint64 hash = index->entries[entry].hash;
+    uint slot = (hash >> 32) & index->slotMask; // Sampling drops hashes by their low bits, homes come from the high ones
+
+    // One slot per distinct hash with its copies chained off it, so long runs of padding don't turn into long probes
+    while(index->slots[slot] != DUPLICATE_EMPTY_SLOT && index->entries[index->slots[slot]].hash != hash) {
+        slot = (slot + 1) & index->slotMask;
+    }
+
+    index->entries[entry].next = index->slots[slot];
+    index->slots[slot] = entry;
+}
+
+uint duplicateIndexFind(DuplicateIndex *index, guint64 hash) {
+    uint slot = (hash >> 32) & index->slotMask;
+
+    while(index->slots[slot] != DUPLICATE_EMPTY_SLOT && index->entries[index->slots[slot]].hash != hash) {
+        slot = (slot + 1) & index->slotMask;
+    }
+
+    return index->slots[slot];
+}
+
+void duplicateIndexSample(DuplicateIndex *index) {
+    uint kept = 0;
+
+    // Keep half of the hash space. The choice depends only on the hash so every copy of a kept block is kept too,
+    // the index just sees fewer distinct blocks.
+    index->sampleMask = (index->sampleMask << 1) | 1;
+
+    for(uint i = 0; i < index->numEntries; i++) {
+        if((index->entries[i].hash & index->sampleMask) == 0) {
+            index->entries[kept++] = index->entries[i];
+        }
+    }
+
+    index->numEntries = kept;
+    memset(index->slots, 0xFF, ((ulong) index->slotMask + 1) * sizeof(uint));
+
+    for(uint i = 0; i < index->numEntries; i++) {
+        duplicateIndexInsertSlot(index, i);
+    }
+}
+
+void duplicateIndexAdd(DuplicateIndex *index, BlockHash *block) {
+    uint head = DUPLICATE_EMPTY_SLOT;
+
+    while(TRUE) {
+        if((block->hash & index->sampleMask) != 0) {
+            return;
+        }
+
+        head = duplicateIndexFind(index, block->hash);
+        if(head != DUPLICATE_EMPTY_SLOT && index->entries[head].copies >= DUPLICATE_MAX_CHAIN) {
+            // Enough copies are stored to show, padding and the like only get counted from here on
+            // instead of filling the index and sampling themselves out
+            index->entries[head].copies++;
+            return;
+        }
+
+        if(index->numEntries < index->capacity) {
+            break;
+        }
+
+        duplicateIndexSample(index);
+    }
+
+    index->entries[index->numEntries] = *block;
+    index->entries[index->numEntries].copies = (head != DUPLICATE_EMPTY_SLOT ? index->entries[head].copies : 0) + 1;
+    duplicateIndexInsertSlot(index, index->numEntries);
+    index->numEntries++;
+}
+
+void scanDuplicatesChunk(ScanJob *job, ScanChunk *chunk) {
+    DuplicateOptions *options = job->data;
+    const byte *buffer = state.fileBuffer;
+
+    // Every chunk starts a new block so the workers don't depend on each other. Content defined cuts line up
+    // again a few blocks after the forced one, findBlockAt replays the same rule.
+    for(ulong position = chunk->start; position < chunk->end;) {
+        BlockHash block = {0};
+
+        block.offset = position;
+        block.length = nextBlockLength(buffer + position, chunk->end - position, options->mode, options->blockSize);
+        block.hash = hashBlock(buffer + position, block.length);
+        g_array_append_val(chunk->results, block);
+
+        position += block.length;
+
+        if(g_atomic_int_get(&job->cancelled)) {
+            break;
+        }
+    }
+}
+
+void mergeDuplicatesChunk(ScanJob *job, ScanChunk *chunk) {
+    DuplicateOptions *options = job->data;
+    DuplicateIndex *index = options->index;
+
+    // Added in file order, so the copies kept under DUPLICATE_MAX_CHAIN are always the first ones
+    index->blocksSeen += chunk->results->len;
+    for(uint i = 0; i < chunk->results->len; i++) {
+        duplicateIndexAdd(index, &g_array_index(chunk->results, BlockHash, i));
+    }
+
+    g_array_set_size(chunk->results, 0);
+}
+
+void duplicateScanFinished(ScanJob *job, GArray *results) {
+    DuplicateOptions *options = job->data;
+    DuplicateIndex *index = options->index;
+    ulong repeatedBlocks = 0;
+    ulong repeatedBytes = 0;
+    ulong cappedBlocks = 0;
+    char sampleNote[64] = {0};
+    char capNote[96] = {0};
+
+    state.duplicateJob = NULL;
+    stopDuplicateScan();
+
+    state.duplicateMode = options->mode;
+    state.duplicateBlockSize = options->blockSize;
+    state.duplicateFileLength = job->fileLength;
+    g_array_free(results, TRUE);
+
+    // Every copy after the first repeats it, hash collisions are rare enough to ignore for a summary
+    for(uint slot = 0; slot <= index->slotMask; slot++) {
+        if(index->slots[slot] == DUPLICATE_EMPTY_SLOT) {
+            continue;
+        }
+
+        BlockHash *head = &index->entries[index->slots[slot]];
+        repeatedBlocks += head->copies - 1;
+        repeatedBytes += (ulong) (head->copies - 1) * head->length;
+
+        if(head->copies > DUPLICATE_MAX_CHAIN) {
+            cappedBlocks++;
+        }
+    }
+
+    if(index->sampleMask) {
+        snprintf(sampleNote, 64, ", 1 in %lu sampled to fit the index", (ulong) index->sampleMask + 1);
+    }
+
+    if(cappedBlocks) {
+        snprintf(capNote, 96, "\n%lu blocks have more than %d copies, only the first %d of each are shown", cappedBlocks, DUPLICATE_MAX_CHAIN, DUPLICATE_MAX_CHAIN);
+    }
+
+    char *repeatedSize = g_format_size(repeatedBytes * (index->sampleMask + 1));
+    GtkWidget *infoDialog = gtk_message_dialog_new(GTK_WINDOW(state.window), GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT, GTK_MESSAGE_INFO, GTK_BUTTONS_CLOSE, "Indexed %u of %lu blocks%s\n%lu blocks repeat an earlier one, about %s in total%s", index->numEntries, index->blocksSeen, sampleNote, repeatedBlocks, repeatedSize, capNote);
+    gtk_dialog_run(GTK_DIALOG(infoDialog));
+    gtk_widget_destroy(infoDialog);
+    g_free(repeatedSize);
+}
+
+gboolean duplicateUpdateProgress(gpointer data) {
+    if(!state.duplicateJob) {
+        return G_SOURCE_REMOVE;
+    }
+
+    gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(state.duplicateProgressBar), scanJobProgress(state.duplicateJob));
+
+    return G_SOURCE_CONTINUE;
+}
+
+void duplicateDialogResponse(GtkWidget *dialog, gint response, gpointer data) {
+    stopDuplicateScan();
+}
+
+void stopDuplicateScan() {
+    if(state.duplicateJob) {
+        cancelScanJob(state.duplicateJob);
+        state.duplicateJob = NULL;
+
+        // Half built, the workers are gone so it can go too
+        freeDuplicateIndex(state.duplicateIndex);
+        state.duplicateIndex = NULL;
+    }
+
+    if(state.duplicateTimerId) {
+        g_source_remove(state.duplicateTimerId);
+        state.duplicateTimerId = 0;
+    }
+
+    if(state.duplicateDialog) {
+        gtk_widget_destroy(state.duplicateDialog);
+        state.duplicateDialog = NULL;
+        state.duplicateProgressBar = NULL;
+    }
+}
+
+void clearDuplicates() {
+    if(state.duplicateOffsets) {
+        g_array_free(state.duplicateOffsets, TRUE);
+        state.duplicateOffsets = NULL;
+    }
+
+    state.duplicateLength = 0;
+
+    if(state.viewWidgetsBox) {
+        gtk_widget_queue_draw(state.viewWidgetsBox);
+    }
+}
+
+void duplicatesMenuAction(GtkMenuItem *menuItem) {
+    static const char *modeNames[] = {"Fixed size blocks", "Content defined blocks"};
+
+    GtkWidget *dialog = NULL;
+    GtkWidget *dialogCBox = NULL;
+    GtkWidget *grid = NULL;
+    GtkWidget *modeCombo = NULL;
+    GtkWidget *blockSizeCombo = NULL;
+    GtkWidget *indexSizeSpin = NULL;
+
+    if(!state.file || state.fileLength == 0 || state.duplicateJob) {
+        return;
+    }
+
+    dialog = gtk_dialog_new_with_buttons("Find Duplicate Blocks", GTK_WINDOW(state.window), GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT, "Cancel", GTK_RESPONSE_CANCEL, "Scan", GTK_RESPONSE_ACCEPT, NULL);
+
+    modeCombo = gtk_combo_box_text_new();
+    for(int i = 0; i < G_N_ELEMENTS(modeNames); i++) {
+        gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(modeCombo), modeNames[i]);
+    }
+    gtk_combo_box_set_active(GTK_COMBO_BOX(modeCombo), DUPLICATE_FIXED);
+
+    // Powers of two so content defined cuts can use a mask and fixed blocks tile the scan chunks
+    blockSizeCombo = gtk_combo_box_text_new();
+    for(uint size = 512; size <= 65536; size <<= 1) {
+        char label[16] = {0};
+
+        snprintf(label, 16, "%u", size);
+        gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(blockSizeCombo), label, label);
+    }
+    gtk_combo_box_set_active_id(GTK_COMBO_BOX(blockSizeCombo), G_STRINGIFY(DUPLICATE_DEFAULT_BLOCK_SIZE));
+
+    indexSizeSpin = gtk_spin_button_new_with_range(1, 4096, 1);
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(indexSizeSpin), DUPLICATE_DEFAULT_INDEX_MB);
+
+    grid = gtk_grid_new();
+    gtk_grid_set_row_spacing(GTK_GRID(grid), BOX_SPACING_PX);
+    gtk_grid_set_column_spacing(GTK_GRID(grid), BOX_SPACING_PX);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Blocks"), 0, 0, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), modeCombo, 1, 0, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Block Size"), 0, 1, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), blockSizeCombo, 1, 1, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), gtk_label_new("Index Size (MB)"), 0, 2, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), indexSizeSpin, 1, 2, 1, 1);
+
+    dialogCBox = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
+    gtk_box_pack_start(GTK_BOX(dialogCBox), grid, FALSE, FALSE, 0);
+    gtk_widget_show_all(dialog);
+
+    if(gtk_dialog_run(GTK_DIALOG(dialog)) != GTK_RESPONSE_ACCEPT) {
+        gtk_widget_destroy(dialog);
+        return;
+    }
+
+    DuplicateOptions *options = calloc(1, sizeof(DuplicateOptions));
+    options->mode = gtk_combo_box_get_active(GTK_COMBO_BOX(modeCombo));
+    options->blockSize = strtoul(gtk_combo_box_get_active_id(GTK_COMBO_BOX(blockSizeCombo)), NULL, 10);
+    ulong indexBytes = (ulong) gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(indexSizeSpin)) * 1024 * 1024;
+
+    gtk_widget_destroy(dialog);
+
+    if(!state.gearTableValid) {
+        buildGearTable();
+    }
+
+    clearDuplicates();
+    if(state.duplicateIndex) {
+        freeDuplicateIndex(state.duplicateIndex);
+    }
+    state.duplicateIndex = newDuplicateIndex(indexBytes);
+    options->index = state.duplicateIndex;
+
+    state.duplicateDialog = gtk_dialog_new_with_buttons("Finding Duplicate Blocks", GTK_WINDOW(state.window), GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT, "Cancel", GTK_RESPONSE_CANCEL, NULL);
+    g_signal_connect(state.duplicateDialog, "response", G_CALLBACK(duplicateDialogResponse), NULL);
+
+    state.duplicateProgressBar = gtk_progress_bar_new();
+    dialogCBox = gtk_dialog_get_content_area(GTK_DIALOG(state.duplicateDialog));
+    gtk_box_pack_start(GTK_BOX(dialogCBox), state.duplicateProgressBar, FALSE, FALSE, 0);
+    gtk_widget_show_all(state.duplicateDialog);
+
+    state.duplicateJob = startScanJob(SCAN_CHUNK_SIZE, sizeof(BlockHash), scanDuplicatesChunk, mergeDuplicatesChunk, duplicateScanFinished, options);
+    state.duplicateTimerId = g_timeout_add(EXPORT_PROGRESS_INTERVAL_MS, duplicateUpdateProgress, NULL);
+}
+
+void findBlockAt(ulong offset, ulong *start, ulong *length) {
+    ulong chunkEnd = 0;
+
+    // Walk the same cuts the scan made from the start of offset's scan chunk
+    *start = offset - offset % SCAN_CHUNK_SIZE;
+    chunkEnd = MIN(*start + SCAN_CHUNK_SIZE, state.duplicateFileLength);
+
+    while(TRUE) {
+        *length = nextBlockLength(state.fileBuffer + *start, chunkEnd - *start, state.duplicateMode, state.duplicateBlockSize);
+
+        if(*start + *length > offset) {
+            return;
+        }
+
+        *start += *length;
+    }
+}
+
+gint compareOffsets(gconstpointer a, gconstpointer b) {
+    ulong first = *(const ulong *) a;
+    ulong second = *(const ulong *) b;
+
+    return first < second ? -1 : first > second;
+}
+
+void showDuplicatesMenuAction(GtkMenuItem *menuItem) {
+    DuplicateIndex *index = state.duplicateIndex;
+    ulong reference = (ulong) gtk_adjustment_get_value(state.scrollAdj) * LINE_LENGTH;
+    ulong selectionEnd = 0;
+    ulong blockStart = 0;
+    ulong blockLength = 0;
+    const char *problem = NULL;
+    char capNote[80] = {0};
+
+    if(!state.file || state.fileLength == 0) {
+        return;
+    }
+
+    getSelection(&reference, &selectionEnd);
+    reference = MIN(reference, state.fileLength - 1);
+
+    if(!index || state.duplicateJob) {
+        problem = "Find duplicate blocks first";
+    }
+    else if(reference >= state.duplicateFileLength) {
+        problem = "This part of the stream arrived after the scan";
+    }
+    else {
+        findBlockAt(reference, &blockStart, &blockLength);
+        guint64 hash = hashBlock(state.fileBuffer + blockStart, blockLength);
+
+        if((hash & index->sampleMask) != 0) {
+            problem = "This block was sampled out of the index, try a larger index size";
+        }
+        else {
+            GArray *offsets = g_array_new(FALSE, FALSE, sizeof(ulong));
+
+            uint head = duplicateIndexFind(index, hash);
+
+            // Equal hashes are only candidates, the bytes decide
+            for(uint entry = head; entry != DUPLICATE_EMPTY_SLOT; entry = index->entries[entry].next) {
+                BlockHash *other = &index->entries[entry];
+
+                if(other->length == blockLength && memcmp(state.fileBuffer + other->offset, state.fileBuffer + blockStart, blockLength) == 0) {
+                    g_array_append_val(offsets, other->offset);
+                }
+            }
+
+            if(offsets->len < 2) {
+                g_array_free(offsets, TRUE);
+                problem = "The block here has no other copies";
+            }
+            else {
+                clearDuplicates();
+                g_array_sort(offsets, compareOffsets);
+                state.duplicateOffsets = offsets;
+                state.duplicateLength = blockLength;
+                gtk_widget_queue_draw(state.viewWidgetsBox);
+
+                if(index->entries[head].copies > DUPLICATE_MAX_CHAIN) {
+                    snprintf(capNote, 80, "Showing %u of %u copies, the index only keeps the first %d", offsets->len, index->entries[head].copies, DUPLICATE_MAX_CHAIN);
+                    problem = capNote;
+                }
+            }
+        }
+    }
+
+    if(problem) {
+        GtkWidget *infoDialog = gtk_message_dialog_new(GTK_WINDOW(state.window), GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT, GTK_MESSAGE_INFO, GTK_BUTTONS_CLOSE, "%s", problem);
+        gtk_dialog_run(GTK_DIALOG(infoDialog));
+        gtk_widget_destroy(infoDialog);
+    }
+}
+
+uint findDuplicateOccurrence(ulong offset) {
+    uint low = 0;
+    uint high = state.duplicateOffsets ? state.duplicateOffsets->len : 0;
+
+    // First occurrence starting at or after offset
+    while(low < high) {
+        uint middle = low + (high - low) / 2;
+
+        if(g_array_index(state.duplicateOffsets, ulong, middle) < offset) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+void jumpToDuplicate(int direction) {
+    ulong reference = (ulong) gtk_adjustment_get_value(state.scrollAdj) * LINE_LENGTH;
+    ulong start = 0;
+    ulong end = 0;
+    uint index = 0;
+
+    if(!state.duplicateOffsets) {
+        return;
+    }
+
+    bool haveSelection = getSelection(&start, &end);
+    if(haveSelection) {
+        reference = start;
+    }
+
+    if(direction > 0) {
+        index = findDuplicateOccurrence(haveSelection ? reference + 1 : reference);
+    }
+    else {
+        index = findDuplicateOccurrence(reference);
+        if(index == 0) {
+            return;
+        }
+        index--;
+    }
+
+    if(index >= state.duplicateOffsets->len) {
+        return;
+    }
+
+    jumpToRange(g_array_index(state.duplicateOffsets, ulong, index), state.duplicateLength);
+}
+
+void nextDuplicateMenuAction(GtkMenuItem *menuItem) {
+    jumpToDuplicate(1);
+}
+
+void previousDuplicateMenuAction(GtkMenuItem *menuItem) {
+    jumpToDuplicate(-1);
+}
+
+void renderDuplicateBlocks(cairo_t *cr, ulong lineOffset, int y, uint cellChars, uint gapChars) {
+    GdkRGBA highlightColor = DUPLICATE_HIGHLIGHT_COLOR;
+
+    if(!state.duplicateOffsets) {
+        return;
+    }
+
+    cairo_save(cr);
+    gdk_cairo_set_source_rgba(cr, &highlightColor);
+
+    // Occurrences all have the same length so the first one that can reach this line starts at most a block before it
+    ulong first = lineOffset - MIN(lineOffset, state.duplicateLength - 1);
+    for(uint i = findDuplicateOccurrence(first); i < state.duplicateOffsets->len; i++) {
+        ulong start = g_array_index(state.duplicateOffsets, ulong, i);
+        ulong end = start + state.duplicateLength - 1;
+
+        if(start >= lineOffset + LINE_LENGTH) {
+            break;
+        }
+
+        start = MAX(start, lineOffset) - lineOffset;
+        end = MIN(end, lineOffset + LINE_LENGTH - 1) - lineOffset;
+
+        cairo_rectangle(cr, TEXT_MARGIN_PX + start * cellChars * state.fontWidth, y, ((end - start + 1) * cellChars - gapChars) * state.fontWidth, state.fontHeight);
+    }
+
+    cairo_fill(cr);
+    cairo_restore(cr);
+}
+
+char *fontMetricsKey(PangoFontDescription *fontDesc) {
+    char *description = pango_font_description_to_string(fontDesc);
+    GdkScreen *screen = gdk_screen_get_default();
+
+    // Metrics depend on the DPI and the Pango that shaped them as much as on the font
+    char *key = g_strdup_printf("%s@%g/%d", description, screen ? gdk_screen_get_resolution(screen) : -1.0, pango_version());
+
+    g_free(description);
+
+    return key;
+}
+
+bool loadCachedFontMetrics(PangoFontDescription *fontDesc) {
+    GKeyFile *cache = g_key_file_new();
+    char *cachePath = g_build_filename(g_get_user_cache_dir(), "jafhe", "fonts.conf", NULL);
+    char *key = fontMetricsKey(fontDesc);
+    bool found = FALSE;
+
+    if(g_key_file_load_from_file(cache, cachePath, G_KEY_FILE_NONE, NULL) && g_key_file_has_group(cache, key)) {
+        int width = g_key_file_get_integer(cache, key, "width", NULL);
+        int height = g_key_file_get_integer(cache, key, "height", NULL);
+
+        if(width > 0 && height > 0) {
+            state.fontWidth = width;
+            state.fontHeight = height;
+            found = TRUE;
+        }
+    }
+
+    g_key_file_free(cache);
+    g_free(cachePath);
+    g_free(key);
+
+    return found;
+}
+
+void storeFontMetrics(PangoFontDescription *fontDesc) {
+    GKeyFile *cache = g_key_file_new();
+    char *cacheDir = g_build_filename(g_get_user_cache_dir(), "jafhe", NULL);
+    char *cachePath = g_build_filename(cacheDir, "fonts.conf", NULL);
+    char *key = fontMetricsKey(fontDesc);
+
+    g_key_file_load_from_file(cache, cachePath, G_KEY_FILE_KEEP_COMMENTS, NULL);
+    g_key_file_set_integer(cache, key, "width", state.fontWidth);
+    g_key_file_set_integer(cache, key, "height", state.fontHeight);
+
+    // Only a cache, a failed write just means measuring again next time
+    g_mkdir_with_parents(cacheDir, 0700);
+    g_key_file_save_to_file(cache, cachePath, NULL);
+
+    g_key_file_free(cache);
+    g_free(cacheDir);
+    g_free(cachePath);
+    g_free(key);
+}
+
+void ensureFontMetrics() {
+    PangoContext *pangoContext = NULL;
+    PangoFontMetrics *fontMetrics = NULL;
+
+    if(state.fontMetricsValid) {
+        return;
+    }
+
+    pangoContext = gtk_widget_get_pango_context(state.window);
+    fontMetrics = pango_context_get_metrics(pangoContext, state.fontDesc, NULL);
+
+    state.fontHeight = PANGO_PIXELS(pango_font_metrics_get_ascent(fontMetrics)) + PANGO_PIXELS(pango_font_metrics_get_descent(fontMetrics)) + 2;
+    state.fontWidth = getFontWidth(state.window, state.fontDesc);
+    state.fontMetricsValid = TRUE;
+
+    pango_font_metrics_unref(fontMetrics);
+
+    storeFontMetrics(state.fontDesc);
+
+    // Any earlier updateSizeRequests returned without them
+    updateSizeRequests();
+}
+
+void onViewRealize(GtkWidget *widget) {
+    // Last point to measure before the first allocation needs the size requests
+    ensureFontMetrics();
+    updateSizeRequests();
+}
+
+char *sessionGroup(const char *path) {
+    // Paths can hold characters group names can't
+    char *digest = g_compute_checksum_for_string(G_CHECKSUM_MD5, path, -1);
+    char *group = g_strdup_printf("File %s", digest);
+
+    g_free(digest);
+
+    return group;
+}
+
+void loadSession() {
+    char *sessionPath = g_build_filename(g_get_user_config_dir(), "jafhe", "session.conf", NULL);
+
+    state.session = g_key_file_new();
+    g_key_file_load_from_file(state.session, sessionPath, G_KEY_FILE_KEEP_COMMENTS, NULL);
+
+    g_free(sessionPath);
+}
+
+void writeSession() {
+    char *sessionDir = g_build_filename(g_get_user_config_dir(), "jafhe", NULL);
+    char *sessionPath = g_build_filename(sessionDir, "session.conf", NULL);
+    GError *error = NULL;
+
+    if(!state.session || state.startupBenchmark) {
+        g_free(sessionDir);
+        g_free(sessionPath);
+        return;
+    }
+
+    if(state.sessionWriteId) {
+        g_source_remove(state.sessionWriteId);
+        state.sessionWriteId = 0;
+    }
+    state.sessionDirty = FALSE;
+
+    g_mkdir_with_parents(sessionDir, 0700);
+    if(!g_key_file_save_to_file(state.session, sessionPath, &error)) {
+        g_warning("Couldn't save the session to %s: %s", sessionPath, error->message);
+        g_error_free(error);
+    }
+
+    g_free(sessionDir);
+    g_free(sessionPath);
+}
+
+gboolean sessionWriteIdle(gpointer data) {
+    state.sessionWriteId = 0;
+    writeSession();
+
+    return G_SOURCE_REMOVE;
+}
+
+void queueSessionWrite() {
+    state.sessionDirty = TRUE;
+
+    // Saving fsyncs, which has no business before the first frame. onFirstFrame picks up anything queued until then.
+    if(state.firstFrameShown && !state.sessionWriteId) {
+        state.sessionWriteId = g_idle_add_full(G_PRIORITY_LOW, sessionWriteIdle, NULL, NULL);
+    }
+}
+
+void rememberRecentFile(const char *path) {
+    gsize numFiles = 0;
+    char **files = g_key_file_get_string_list(state.session, "Session", "files", &numFiles, NULL);
+    const char *recent[SESSION_MAX_FILES] = {0};
+    gsize numRecent = 0;
+
+    recent[numRecent++] = path;
+
+    for(gsize i = 0; i < numFiles; i++) {
+        if(strcmp(files[i], path) == 0) {
+            continue;
+        }
+
+        if(numRecent < SESSION_MAX_FILES) {
+            recent[numRecent++] = files[i];
+        }
+        else {
+            // Fell off the end of the list, its position and hints go with it
+            char *group = sessionGroup(files[i]);
+            g_key_file_remove_group(state.session, group, NULL);
+            g_free(group);
+        }
+    }
+
+    g_key_file_set_string_list(state.session, "Session", "files", recent, numRecent);
+
+    g_strfreev(files);
+}
+
+void rememberFileSession() {
+    struct stat fileStat = {0};
+    char *hints[SESSION_MAX_HINTS] = {0};
+    gsize numHints = 0;
+
+    if(!state.session || !state.fileFullName || state.fileFromStdin || fstat(fileno(state.file), &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+        return;
+    }
+
+    char *group = sessionGroup(state.fileFullName);
+
+    g_key_file_set_string(state.session, group, "path", state.fileFullName);
+    g_key_file_set_uint64(state.session, group, "size", state.fileLength);
+    g_key_file_set_int64(state.session, group, "mtime", fileStat.st_mtime);
+    g_key_file_set_double(state.session, group, "scroll", gtk_adjustment_get_value(state.scrollAdj));
+
+    // The chunks that were on screen this time, as ranges, are what gets read ahead on the next open
+    if(state.prefetchChunkState) {
+        ulong budget = PREFETCH_MAX_BYTES / PREFETCH_CHUNK_SIZE;
+
+        for(ulong chunk = 0; chunk < state.prefetchNumChunks && numHints < SESSION_MAX_HINTS && budget > 0; chunk++) {
+            if(!(state.prefetchChunkState[chunk] & PREFETCH_CHUNK_SEEN)) {
+                continue;
+            }
+
+            ulong first = chunk;
+            while(chunk + 1 < state.prefetchNumChunks && (state.prefetchChunkState[chunk + 1] & PREFETCH_CHUNK_SEEN) && chunk + 1 - first < budget) {
+                chunk++;
+            }
+
+            budget -= chunk + 1 - first;
+            hints[numHints++] = g_strdup_printf("%lX-%lX", first * PREFETCH_CHUNK_SIZE, MIN((chunk + 1) * PREFETCH_CHUNK_SIZE, state.fileLength));
+        }
+    }
+
+    g_key_file_set_string_list(state.session, group, "hints", (const char * const *) hints, numHints);
+
+    for(gsize i = 0; i < numHints; i++) {
+        g_free(hints[i]);
+    }
+    g_free(group);
+}
+
+void restoreFileSession() {
+    struct stat fileStat = {0};
+    char *group = sessionGroup(state.fileFullName);
+
+    if(!g_key_file_has_group(state.session, group) || fstat(fileno(state.file), &fileStat) != 0) {
+        g_free(group);
+        return;
+    }
+
+    // Anything remembered about a file that has changed since is wrong
+    if(g_key_file_get_uint64(state.session, group, "size", NULL) != state.fileLength || g_key_file_get_int64(state.session, group, "mtime", NULL) != fileStat.st_mtime) {
+        g_key_file_remove_group(state.session, group, NULL);
+        g_free(group);
+        return;
+    }
+
+    double scroll = g_key_file_get_double(state.session, group, "scroll", NULL);
+    gtk_adjustment_set_value(state.scrollAdj, clampScrollValue(scroll));
+
+    if(state.fileMapped) {
+        gsize numHints = 0;
+        char **hints = g_key_file_get_string_list(state.session, group, "hints", &numHints, NULL);
+        long pageSize = sysconf(_SC_PAGESIZE);
+
+        // The restored screen first, then where the last session spent its time. WILLNEED only queues the reads.
+        ulong viewStart = (ulong) scroll * LINE_LENGTH;
+        ulong viewStartPage = viewStart - viewStart % pageSize;
+        madvise(state.fileBuffer + viewStartPage, MIN(PREFETCH_CHUNK_SIZE, state.fileLength - viewStartPage), MADV_WILLNEED);
+
+        for(gsize i = 0; i < numHints; i++) {
+            char *rest = NULL;
+            ulong start = strtoul(hints[i], &rest, 16);
+            ulong end = (*rest == '-') ? strtoul(rest + 1, NULL, 16) : 0;
+
+            if(start % pageSize != 0 || start >= end || end > state.fileLength) {
+                continue;
+            }
+
+            madvise(state.fileBuffer + start, end - start, MADV_WILLNEED);
+        }
+
+        g_strfreev(hints);
+    }
+
+    g_free(group);
+}
+
+void recentMenuAction(GtkMenuItem *menuItem) {
+    // Opening rebuilds the menu this item lives in
+    char *path = g_strdup(g_object_get_data(G_OBJECT(menuItem), "path"));
+
+    openFile(path);
+    updateTitle();
+
+    g_free(path);
+}
+
+void rebuildRecentMenu() {
+    gsize numFiles = 0;
+    char **files = NULL;
+
+    if(!state.recentMenu) {
+        return;
+    }
+
+    gtk_container_foreach(GTK_CONTAINER(state.recentMenu), (GtkCallback) gtk_widget_destroy, NULL);
+
+    files = g_key_file_get_string_list(state.session, "Session", "files", &numFiles, NULL);
+    for(gsize i = 0; i < numFiles; i++) {
+        GtkWidget *item = gtk_menu_item_new_with_label(files[i]);
+
+        g_object_set_data_full(G_OBJECT(item), "path", g_strdup(files[i]), g_free);
+        g_signal_connect(G_OBJECT(item), "activate", G_CALLBACK(recentMenuAction), NULL);
+        gtk_menu_shell_append(GTK_MENU_SHELL(state.recentMenu), item);
+    }
+
+    gtk_widget_show_all(state.recentMenu);
+    gtk_widget_set_sensitive(state.recentMenuI, numFiles > 0);
+
+    g_strfreev(files);
+}
 
-    state.fileBuffer = malloc(state.fileLength + 1);
-    memset(state.fileBuffer, 0, state.fileLength + 1);
-    fread(state.fileBuffer, 1, state.fileLength, state.file);
+void onFirstFrame(GdkFrameClock *frameClock, gpointer data) {
+    double elapsed = (g_get_monotonic_time() - state.startupTime) / 1000.0;
 
-    state.fileNumLines = jceil((float) state.fileLength / (float) LINE_LENGTH);
+    g_signal_handlers_disconnect_by_func(frameClock, G_CALLBACK(onFirstFrame), data);
 
-    toggleMenuSensitivity();
-    updateSizeRequests();
+    state.firstFrameShown = TRUE;
+    if(state.sessionDirty) {
+        queueSessionWrite();
+    }
 
-    if(state.viewWidgetsBox) {
-        gtk_widget_queue_draw(state.viewWidgetsBox);
+    if(state.startupBenchmark) {
+        g_print("First frame after %.2f ms%s\n", elapsed, state.fileFullName ? " with a file open" : "");
+        gtk_main_quit();
+    }
+    else {
+        g_debug("First frame after %.2f ms", elapsed);
     }
 }
 
-void openMenuAction(GtkMenuItem *menuItem) {
-    GtkWidget *dialog = NULL;
-    gint dialogResult = 0;
-
-    dialog = gtk_file_chooser_dialog_new("Open File", GTK_WINDOW(state.window), GTK_FILE_CHOOSER_ACTION_OPEN, "Cancel", GTK_RESPONSE_CANCEL, "Open", GTK_RESPONSE_ACCEPT, NULL);
+double clampScrollValue(double value) {
+    double upper = gtk_adjustment_get_upper(state.scrollAdj);
+    double pSize = gtk_adjustment_get_page_size(state.scrollAdj);
 
-    dialogResult = gtk_dialog_run(GTK_DIALOG(dialog));
-    if(dialogResult == GTK_RESPONSE_ACCEPT) {
-        char *filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
-        openFile(filename);
-        g_free(filename);
+    if(value > upper - pSize) {
+        value = upper - pSize;
     }
 
-    updateTitle();
-
-    gtk_widget_destroy(dialog);
-}
+    if(value < 0) {
+        value = 0;
+    }
 
-void gotoActivateCallback(GtkWidget *widget, gpointer data) {
-    gtk_dialog_response(GTK_DIALOG(data), GTK_RESPONSE_ACCEPT);
+    return value;
 }
 
-void openGotoDialog() {
-    GtkWidget *dialog = NULL;
-    GtkWidget *dialogCBox = NULL;
-    GtkWidget *entry = NULL;
-
-    bool done = FALSE;
-    gint response = 0;
+void scrollByLines(double lines) {
+    if(!state.scrollAdj || !state.file) {
+        return;
+    }
 
-    dialog = gtk_dialog_new_with_buttons("Jump To Offset", GTK_WINDOW(state.window), GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT, "Cancel", GTK_RESPONSE_CANCEL, "Open", GTK_RESPONSE_ACCEPT, NULL);
-    gtk_widget_set_events(dialog, GDK_KEY_PRESS_MASK);
+    // Relative to the target rather than the current value so held keys and fast wheels don't lose steps
+    state.scrollTarget = clampScrollValue(state.scrollTarget + lines);
 
-    entry = gtk_entry_new();
-    g_signal_connect(entry, "activate", G_CALLBACK(gotoActivateCallback), dialog); // Done this way because gtk_dialog_add_action_widget doesn't working
-    dialogCBox = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
-    gtk_box_pack_start(GTK_BOX(dialogCBox), entry, FALSE, FALSE, 0);
-    gtk_widget_show(entry);
+    if(!state.scrollTickId) {
+        state.scrollLastFrame = 0;
+        state.scrollTickId = gtk_widget_add_tick_callback(state.viewWidgetsBox, onScrollTick, NULL, NULL);
+    }
+}
 
-    while(!done) {
-        response = gtk_dialog_run(GTK_DIALOG(dialog));
+gboolean onScrollTick(GtkWidget *widget, GdkFrameClock *frameClock, gpointer data) {
+    gint64 frameTime = gdk_frame_clock_get_frame_time(frameClock);
+    double elapsed = 1.0 / 60.0;
 
-        if(response == GTK_RESPONSE_ACCEPT) {
-            const char *entryText = gtk_entry_get_text(GTK_ENTRY(entry));
-            char *rest = NULL;
-            long offset = 0;
+    if(state.scrollLastFrame) {
+        elapsed = MIN((double) (frameTime - state.scrollLastFrame) / G_USEC_PER_SEC, 0.1);
+    }
+    state.scrollLastFrame = frameTime;
 
-            offset = strtol(entryText, &rest, 16);
+    if(state.scrollVelocity != 0) {
+        state.scrollTarget += state.scrollVelocity * elapsed;
+        state.scrollVelocity *= exp(-SCROLL_FRICTION * elapsed);
 
-            if(strlen(rest) != 0) {
-                GtkWidget *invalidDialog = gtk_message_dialog_new(GTK_WINDOW(dialog), GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT, GTK_MESSAGE_ERROR, GTK_BUTTONS_CLOSE, "Invalid Offset: \"%s\"", entryText);
-                gtk_dialog_run(GTK_DIALOG(invalidDialog));
-                gtk_widget_destroy(invalidDialog);
-                gtk_entry_set_text(GTK_ENTRY(entry), "");
-                gtk_widget_grab_focus(GTK_WIDGET(entry));
-            } 
-            else {
-                // Success
-                // TODO(Adin): Update for resizable lines
-                offset >>= 4; // Divide by line length (2^4 or 16)
-                int adjUpper = gtk_adjustment_get_upper(state.scrollAdj);
-                int adjPSize = gtk_adjustment_get_page_size(state.scrollAdj);
-                CLAMP_VALUE(offset, 0, adjUpper - adjPSize);
-                gtk_adjustment_set_value(state.scrollAdj, offset);
-                done = TRUE;
-            }
-            
-        }
-        else {
-            done = TRUE;
+        double clamped = clampScrollValue(state.scrollTarget);
+        if(clamped != state.scrollTarget || fabs(state.scrollVelocity) < SCROLL_MIN_VELOCITY) {
+            state.scrollVelocity = 0;
         }
     }
 
-    gtk_widget_destroy(dialog);
-}
+    // The range can shrink under a scroll in progress (resize, the extra line for a cut off last row),
+    // a target outside it would never be reached
+    state.scrollTarget = clampScrollValue(state.scrollTarget);
 
-void gotoMenuAction(GtkWidget *widget) {
-    if(state.file) {
-        openGotoDialog();
-    }
-}
+    double value = gtk_adjustment_get_value(state.scrollAdj);
+    double diff = state.scrollTarget - value;
 
-void fontMenuAction(GtkMenuItem *menuItem) {
-    GtkWidget *dialog = NULL;
-    gint dialogResult = 0;
+    if(fabs(diff) < SCROLL_SETTLE_LINES) {
+        value = state.scrollTarget;
+    }
+    else {
+        value += diff * (1.0 - exp(-elapsed / SCROLL_EASE_SEC));
+    }
 
-    dialog = gtk_font_chooser_dialog_new("Choose Font", GTK_WINDOW(state.window));
-    gtk_font_chooser_set_font_desc(GTK_FONT_CHOOSER(dialog), state.fontDesc);
+    // All the input since the last frame collapses into this one value change and one redraw
+    state.scrollFromTick = TRUE;
+    gtk_adjustment_set_value(state.scrollAdj, value);
+    state.scrollFromTick = FALSE;
 
-    dialogResult = gtk_dialog_run(GTK_DIALOG(dialog));
-    if(dialogResult == GTK_RESPONSE_OK) {
-        PangoFontDescription *fontDesc = gtk_font_chooser_get_font_desc(GTK_FONT_CHOOSER(dialog));
+    // Whatever the adjustment actually took, not what was asked of it
+    value = gtk_adjustment_get_value(state.scrollAdj);
 
-        updateFont(pango_font_description_copy(fontDesc));
+    if(fabs(state.scrollTarget - value) < SCROLL_SETTLE_LINES && state.scrollVelocity == 0) {
+        state.scrollTickId = 0;
+        return G_SOURCE_REMOVE;
     }
 
-    gtk_widget_destroy(dialog);
+    return G_SOURCE_CONTINUE;
 }
 
 bool onKeyPress(GtkWidget *widget, GdkEventKey *event) {
     switch(event->keyval) {
         case GDK_KEY_k:
         case GDK_KEY_Up:
-            if(state.scrollAdj && state.file) {
-                int newValue = gtk_adjustment_get_value(state.scrollAdj) - 1;
-
-                if(newValue < 0) {
-                    newValue = 0;
-                }
-
-                gtk_adjustment_set_value(state.scrollAdj, newValue);
-            }
+            scrollByLines(-1);
             break;
 
         case GDK_KEY_j:
         case GDK_KEY_Down:
-            if(state.scrollAdj && state.file) {
-                int newValue = gtk_adjustment_get_value(state.scrollAdj) + 1;
-                int upper = gtk_adjustment_get_upper(state.scrollAdj);
-                int pSize = gtk_adjustment_get_page_size(state.scrollAdj);
+            scrollByLines(1);
+            break;
 
-                if(newValue > upper - pSize) {
-                    newValue = upper - pSize;
-                }
+        case GDK_KEY_Page_Up:
+            if(state.scrollAdj) {
+                scrollByLines(-gtk_adjustment_get_page_size(state.scrollAdj));
+            }
+            break;
 
-                gtk_adjustment_set_value(state.scrollAdj, newValue);
+        case GDK_KEY_Page_Down:
+            if(state.scrollAdj) {
+                scrollByLines(gtk_adjustment_get_page_size(state.scrollAdj));
             }
             break;
+
+        case GDK_KEY_Escape:
+            clearSelection();
+            break;
     }
 
     return FALSE;
 }
 
 void onUpdateSize(GtkWidget *widget, GdkRectangle *newRectangle) {
+    ensureFontMetrics();
+
     if(newRectangle) {
         state.widgetHeight = newRectangle->height; 
     }
@@ -311,32 +4473,82 @@ void onUpdateSize(GtkWidget *widget, GdkRectangle *newRectangle) {
     }
 
     if(state.scrollAdj) {
-        uint value = gtk_adjustment_get_value(state.scrollAdj);
+        double value = gtk_adjustment_get_value(state.scrollAdj); // Fractional while a smooth scroll is in progress
         gtk_adjustment_configure(state.scrollAdj, value, 0, (state.widgetHeight % state.fontHeight ? state.fileNumLines + 1 : state.fileNumLines), 1, 1, state.numLines); // Ternary adjusts for rendering cutoff last line in file
     }
 }
 
 void onAdjValueChanged(GtkAdjustment *adj) {
+    if(!state.scrollFromTick) {
+        // Something else moved the view (scrollbar drag, goto, resize), drop any animation in progress
+        state.scrollTarget = gtk_adjustment_get_value(adj);
+        state.scrollVelocity = 0;
+    }
+
+    // Every scroll source (keys, wheel, dragging the scrollbar, goto) ends up here
+    updatePrefetch(gtk_adjustment_get_value(adj));
+    streamRequestView(gtk_adjustment_get_value(adj));
+
     if(state.viewWidgetsBox) {
         gtk_widget_queue_draw(state.viewWidgetsBox);
     }
 }
 
-void onScrollEvent(GtkWidget *widget, GdkEvent *event) {
-    gtk_widget_event(state.scrollBar, event);
+bool onScrollEvent(GtkWidget *widget, GdkEvent *event) {
+    GdkEventScroll *scroll = &event->scroll;
+
+    switch(scroll->direction) {
+        case GDK_SCROLL_UP:
+            scrollByLines(-SCROLL_WHEEL_LINES);
+            break;
+
+        case GDK_SCROLL_DOWN:
+            scrollByLines(SCROLL_WHEEL_LINES);
+            break;
+
+        case GDK_SCROLL_SMOOTH:
+            if(scroll->is_stop) {
+                // Fingers lifted, keep going with whatever speed the gesture had
+                state.scrollVelocity = state.scrollTrackVelocity;
+                state.scrollTrackVelocity = 0;
+                scrollByLines(0);
+            }
+            else {
+                double lines = scroll->delta_y * SCROLL_WHEEL_LINES;
+                guint32 elapsedMs = scroll->time - state.scrollLastEventTime;
+
+                if(elapsedMs > 0 && elapsedMs < 100) {
+                    state.scrollTrackVelocity = 0.5 * state.scrollTrackVelocity + 0.5 * (lines * 1000.0 / elapsedMs);
+                }
+                else {
+                    state.scrollTrackVelocity = 0;
+                }
+                state.scrollLastEventTime = scroll->time;
+
+                state.scrollVelocity = 0;
+                scrollByLines(lines);
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return TRUE;
 }
 
 void updateTitle() {
-    char titleBuffer[39] = {0}; // 50 bytes for the file + 8 bytes for "JAFHE - " + 1 byte for terminator
+    char titleBuffer[49] = {0}; // 30 bytes for the file + 8 bytes for "JAFHE - " + 10 bytes for " (reading)" + 1 byte for terminator
 
     if(state.fileFullName != NULL) {
         char *fileName = rindex(state.fileFullName, '/') + 1;
+        const char *suffix = state.streamPaused ? " (paused)" : state.streamTimerId ? " (reading)" : ""; // Until a stream has been read to the end
 
         if(strlen(fileName) > 30) {
-            snprintf(titleBuffer, 39, "JAFHE - %.27s...", fileName);
+            snprintf(titleBuffer, 49, "JAFHE - %.27s...%s", fileName, suffix);
         }
         else {
-            snprintf(titleBuffer, 39, "JAFHE - %s", fileName);
+            snprintf(titleBuffer, 49, "JAFHE - %s%s", fileName, suffix);
         }
         gtk_window_set_title(GTK_WINDOW(state.window), titleBuffer);
     }
@@ -346,46 +4558,50 @@ void updateTitle() {
 }
 
 uint getFontWidth(GtkWidget *widget, PangoFontDescription *fontDesc) {
-    PangoLayout *layout = gtk_widget_create_pango_layout(widget, "");
+    PangoLayout *layout = gtk_widget_create_pango_layout(widget, NULL);
+    PangoLayoutIter *iter = NULL;
     PangoRectangle rect = {0};
 
     uint maxWidth = 0;
-    char str[2] = {0};
-
-    pango_layout_set_font_description(layout, fontDesc);
+    char printable[0x7E - 0x20 + 2] = {0};
 
     for(int i = 0x20; i <= 0x7E; i++) {
-        snprintf(str, 2, "%c", (char) i);
-        pango_layout_set_text(layout,  str, -1);
-        pango_layout_get_pixel_extents(layout, NULL, &rect);
-
-        maxWidth = MAX(rect.width, maxWidth);
+        printable[i - 0x20] = i;
     }
 
+    pango_layout_set_font_description(layout, fontDesc);
+    pango_layout_set_text(layout, printable, -1);
+
+    // Shaped once as a whole, then every character's advance is read back
+    iter = pango_layout_get_iter(layout);
+    do {
+        pango_layout_iter_get_char_extents(iter, &rect);
+        maxWidth = MAX(PANGO_PIXELS_CEIL(rect.width), maxWidth);
+    } while(pango_layout_iter_next_char(iter));
+
+    pango_layout_iter_free(iter);
     g_object_unref(G_OBJECT(layout));
 
     return maxWidth;
 }
 
 void updateFont(PangoFontDescription *newDesc) {
-    GtkWidget *temp = NULL;
-
-    PangoContext *hexPangoContext = NULL;
-    PangoFontMetrics *fontMetrics = NULL;
-
     pango_font_description_free(state.fontDesc);
     state.fontDesc = newDesc;
 
-    temp = gtk_text_view_new();
+    if(state.session) {
+        char *description = pango_font_description_to_string(state.fontDesc);
+        g_key_file_set_string(state.session, "Session", "font", description);
+        g_free(description);
+    }
 
-    hexPangoContext = gtk_widget_get_pango_context(temp);
-    fontMetrics = pango_context_get_metrics(hexPangoContext, state.fontDesc, NULL);
+    state.fontMetricsValid = loadCachedFontMetrics(state.fontDesc);
 
-    state.fontHeight = PANGO_PIXELS(pango_font_metrics_get_ascent(fontMetrics)) + PANGO_PIXELS(pango_font_metrics_get_descent(fontMetrics)) + 2;
-    state.fontWidth = getFontWidth(temp, state.fontDesc);
+    // Once the view is up there's nothing left to defer to
+    if(state.hexBox && gtk_widget_get_realized(state.hexBox)) {
+        ensureFontMetrics();
+    }
 
-    gtk_widget_destroy(temp);
-    
     updateSizeRequests();
 
     if(state.viewWidgetsBox) {
@@ -396,6 +4612,11 @@ void updateFont(PangoFontDescription *newDesc) {
 void updateSizeRequests() {
     int height = -1;
 
+    if(!state.fontMetricsValid) {
+        // ensureFontMetrics calls back here once they're measured
+        return;
+    }
+
     if(state.file) {
         height = MIN(10, state.fileNumLines) * state.fontHeight;
     }
@@ -417,17 +4638,170 @@ void updateSizeRequests() {
     }
 }
 
-void fillHexBuffer(ulong offset) {
-    // TODO(Adin): Update when lines are resizable
+double adjustRange(double value, double oldmin, double oldmax, double newmin, double newmax) {
+    return ((value - oldmin) / (oldmax - oldmin)) * (newmax - newmin) + newmin;
+}
 
-    for(long i = 0; i < MIN(LINE_LENGTH, state.fileLength - offset); i++) {
-        if(i == 0) {
-            snprintf(state.hexLineBuffer, HEX_BUFFER_LENGTH, "%02X", state.fileBuffer[offset + i]);
+double denormalizeColor(double color) {
+    return adjustRange(color, 0, 1, 0, 255);
+}
+
+Color gdkToColor(GdkRGBA gdkColor) {
+    Color result = {0};
+
+    result.red =   (byte) denormalizeColor(gdkColor.red);
+    result.green = (byte) denormalizeColor(gdkColor.green);
+    result.blue =  (byte) denormalizeColor(gdkColor.blue);
+    result.alpha = (byte) denormalizeColor(gdkColor.alpha);
+
+    return result;
+}
+
+Color parseColor(const char *str, Color fallback) {
+    GdkRGBA parsed = {0};
+
+    if(str && gdk_rgba_parse(&parsed, str)) {
+        return gdkToColor(parsed);
+    }
+
+    return fallback;
+}
+
+void buildByteColors(GtkWidget *widget) {
+    GtkStyleContext *styleContext = gtk_widget_get_style_context(widget);
+    GdkRGBA fgColor = {0};
+
+    GKeyFile *config = g_key_file_new();
+    char *configPath = g_build_filename(g_get_user_config_dir(), "jafhe", "colors.conf", NULL);
+    bool haveConfig = FALSE;
+
+    gtk_style_context_get_color(styleContext, gtk_style_context_get_state(styleContext), &fgColor);
+
+    // Light text means a dark theme, pick whichever palette stays readable on it
+    bool darkTheme = (0.299 * fgColor.red + 0.587 * fgColor.green + 0.114 * fgColor.blue) > 0.5;
+
+    Color base = gdkToColor(fgColor);
+    Color zero = base;
+    Color whitespace = parseColor(darkTheme ? "#8AE234" : "#4E9A06", base);
+    Color control = parseColor(darkTheme ? "#FCAF3E" : "#CE5C00", base);
+    Color allOnes = parseColor(darkTheme ? "#AD7FA8" : "#75507B", base);
+
+    zero.alpha = base.alpha * 0.4;
+
+    haveConfig = g_key_file_load_from_file(config, configPath, G_KEY_FILE_NONE, NULL);
+    if(haveConfig) {
+        char *value = NULL;
+
+        // g_key_file_get_string returns NULL for missing keys which parseColor treats as "keep the default"
+        value = g_key_file_get_string(config, "Colors", "printable", NULL);  base =       parseColor(value, base);       g_free(value);
+        value = g_key_file_get_string(config, "Colors", "zero", NULL);       zero =       parseColor(value, zero);       g_free(value);
+        value = g_key_file_get_string(config, "Colors", "whitespace", NULL); whitespace = parseColor(value, whitespace); g_free(value);
+        value = g_key_file_get_string(config, "Colors", "control", NULL);    control =    parseColor(value, control);    g_free(value);
+        value = g_key_file_get_string(config, "Colors", "ff", NULL);         allOnes =    parseColor(value, allOnes);    g_free(value);
+    }
+
+    for(int i = 0; i <= 0xFF; i++) {
+        if(i == 0x00) {
+            state.byteColors[i] = zero;
+        }
+        else if(i == 0xFF) {
+            state.byteColors[i] = allOnes;
+        }
+        else if(i == ' ' || IN_RANGE(i, '\t', '\r')) {
+            state.byteColors[i] = whitespace;
+        }
+        else if(i < 0x20 || i == 0x7F) {
+            state.byteColors[i] = control;
         }
         else {
-            snprintf(state.hexLineBuffer + HEX_BUFFER_OFFSET(i), HEX_BUFFER_LENGTH - HEX_BUFFER_OFFSET(i), " %02X", state.fileBuffer[offset + i]);
+            state.byteColors[i] = base;
+        }
+    }
+
+    if(haveConfig) {
+        // User ranges look like "80-9F=#FFAA00" and win over the built in classes
+        char **keys = g_key_file_get_keys(config, "Ranges", NULL, NULL);
+
+        for(int i = 0; keys && keys[i]; i++) {
+            char *rest = NULL;
+            ulong first = strtoul(keys[i], &rest, 16);
+            ulong last = first;
+
+            if(*rest == '-') {
+                last = strtoul(rest + 1, &rest, 16);
+            }
+
+            if(*rest != '\0' || first > last || last > 0xFF) {
+                g_warning("Ignoring invalid byte range \"%s\" in %s", keys[i], configPath);
+                continue;
+            }
+
+            char *value = g_key_file_get_string(config, "Ranges", keys[i], NULL);
+            for(ulong b = first; b <= last; b++) {
+                state.byteColors[b] = parseColor(value, state.byteColors[b]);
+            }
+            g_free(value);
+        }
+
+        g_strfreev(keys);
+    }
+
+    state.byteColorsBase = gdkToColor(fgColor);
+    state.byteColorsValid = TRUE;
+
+    g_key_file_free(config);
+    g_free(configPath);
+}
+
+void onStyleUpdated(GtkWidget *widget) {
+    // Theme changed, the table gets rebuilt on the next draw
+    state.byteColorsValid = FALSE;
+}
+
+void applyByteColors(PangoLayout *pangoLayout, ulong offset, uint cellChars, uint textChars) {
+    PangoAttrList *attrs = NULL;
+    ulong count = MIN(LINE_LENGTH, state.fileLength - offset);
+    ulong runStart = 0;
+
+    // Merge equal neighbours so a line only carries a span per color change, and plain text carries none
+    for(ulong i = 1; i <= count; i++) {
+        Color color = state.byteColors[state.fileBuffer[offset + runStart]];
+
+        if(i < count && state.byteColors[state.fileBuffer[offset + i]].RGBA == color.RGBA) {
+            continue;
+        }
+
+        if(color.RGBA != state.byteColorsBase.RGBA) {
+            PangoAttribute *fg = pango_attr_foreground_new(color.red * 257, color.green * 257, color.blue * 257);
+            PangoAttribute *alpha = pango_attr_foreground_alpha_new(color.alpha * 257);
+
+            if(!attrs) {
+                attrs = pango_attr_list_new();
+            }
+
+            fg->start_index = alpha->start_index = runStart * cellChars;
+            fg->end_index = alpha->end_index = (i - 1) * cellChars + textChars;
+
+            pango_attr_list_insert(attrs, fg);
+            pango_attr_list_insert(attrs, alpha);
         }
+
+        runStart = i;
+    }
+
+    pango_layout_set_attributes(pangoLayout, attrs);
+
+    if(attrs) {
+        pango_attr_list_unref(attrs);
     }
+}
+
+void fillHexBuffer(ulong offset) {
+    // TODO(Adin): Update when lines are resizable
+    ulong count = MIN(LINE_LENGTH, state.fileLength - offset);
+
+    formatHex(state.hexLineBuffer, state.fileBuffer + offset, count, LINE_LENGTH);
+    state.hexLineBuffer[HEX_BUFFER_OFFSET(count)] = '\0';
 } 
 
 void fillAsciiBuffer(ulong offset) {
@@ -446,12 +4820,35 @@ void fillAsciiBuffer(ulong offset) {
     }
 }
 
+void renderSelection(cairo_t *cr, GtkStyleContext *styleContext, ulong lineOffset, int y, uint cellChars, uint gapChars) {
+    ulong start = 0;
+    ulong end = 0;
+    GdkRGBA selectedColor = {0.21, 0.52, 0.89, 0.5};
+
+    if(!getSelection(&start, &end) || end < lineOffset || start >= lineOffset + LINE_LENGTH) {
+        return;
+    }
+
+    start = MAX(start, lineOffset) - lineOffset;
+    end = MIN(end, lineOffset + LINE_LENGTH - 1) - lineOffset;
+
+    gtk_style_context_lookup_color(styleContext, "theme_selected_bg_color", &selectedColor);
+
+    cairo_save(cr);
+    gdk_cairo_set_source_rgba(cr, &selectedColor);
+    cairo_rectangle(cr, TEXT_MARGIN_PX + start * cellChars * state.fontWidth, y, ((end - start + 1) * cellChars - gapChars) * state.fontWidth, state.fontHeight);
+    cairo_fill(cr);
+    cairo_restore(cr);
+}
+
 gboolean renderOffsetBox(GtkWidget *widget, cairo_t *cr) {
     if(!state.file) {
         // If there isn't an open file don't render the box
         return FALSE;
     }
 
+    ensureFontMetrics();
+
     GtkStyleContext *styleContext = gtk_widget_get_style_context(widget);
     GtkStateFlags widgetState = gtk_style_context_get_state(styleContext);
 
@@ -472,13 +4869,28 @@ gboolean renderOffsetBox(GtkWidget *widget, cairo_t *cr) {
     gdk_cairo_set_source_rgba(cr, &fgColor);
     pango_layout_set_font_description(pangoLayout, state.fontDesc);
 
-    uint adjValue = gtk_adjustment_get_value(state.scrollAdj);
-    uint linesToDraw = MIN(state.numLines, state.fileNumLines - adjValue);
+    double scrollValue = gtk_adjustment_get_value(state.scrollAdj);
+    uint adjValue = scrollValue;
+    int yOffset = round((scrollValue - adjValue) * state.fontHeight); // Sub-line part of a smooth scroll
+    uint linesToDraw = MIN(state.numLines + 1, state.fileNumLines - adjValue);
     for(int i = 0; i < linesToDraw; i++) {
+        ulong lineOffset = (adjValue * LINE_LENGTH) + i * LINE_LENGTH;
+        uint hit = findSignatureHit(lineOffset);
+
+        // Gutter mark so lines with an embedded file stand out while scrolling
+        if(state.signatureHits && hit < state.signatureHits->len && g_array_index(state.signatureHits, SignatureHit, hit).offset < lineOffset + LINE_LENGTH) {
+            GdkRGBA markerColor = SIGNATURE_MARKER_COLOR;
+
+            gdk_cairo_set_source_rgba(cr, &markerColor);
+            cairo_rectangle(cr, 0, i * (int) state.fontHeight - yOffset, TEXT_MARGIN_PX, state.fontHeight);
+            cairo_fill(cr);
+            gdk_cairo_set_source_rgba(cr, &fgColor);
+        }
+
         snprintf(buffer, 9, "%08X", (adjValue * LINE_LENGTH) + i * LINE_LENGTH);
         pango_layout_set_text(pangoLayout, buffer, 10);
 
-        cairo_move_to(cr, TEXT_MARGIN_PX, i * state.fontHeight);
+        cairo_move_to(cr, TEXT_MARGIN_PX, i * (int) state.fontHeight - yOffset);
         pango_cairo_show_layout(cr, pangoLayout);
     }
 
@@ -493,6 +4905,8 @@ gboolean renderHexBox(GtkWidget *widget, cairo_t *cr) {
         return FALSE;
     }
 
+    ensureFontMetrics();
+
     GtkStyleContext *styleContext = gtk_widget_get_style_context(widget);
     GtkStateFlags widgetState = gtk_style_context_get_state(styleContext);
 
@@ -511,13 +4925,24 @@ gboolean renderHexBox(GtkWidget *widget, cairo_t *cr) {
     gdk_cairo_set_source_rgba(cr, &fgColor);
     pango_layout_set_font_description(pangoLayout, state.fontDesc);
 
-    uint adjValue = gtk_adjustment_get_value(state.scrollAdj);
-    uint linesToDraw = MIN(state.numLines, state.fileNumLines - adjValue);
+    if(!state.byteColorsValid) {
+        buildByteColors(widget);
+    }
+
+    double scrollValue = gtk_adjustment_get_value(state.scrollAdj);
+    uint adjValue = scrollValue;
+    int yOffset = round((scrollValue - adjValue) * state.fontHeight); // Sub-line part of a smooth scroll
+    uint linesToDraw = MIN(state.numLines + 1, state.fileNumLines - adjValue);
     for(int i = 0; i < linesToDraw; i++) {
         fillHexBuffer((adjValue * LINE_LENGTH) + i * LINE_LENGTH);
         pango_layout_set_text(pangoLayout, state.hexLineBuffer, -1);
+        applyByteColors(pangoLayout, (adjValue * LINE_LENGTH) + i * LINE_LENGTH, 3, 2);
 
-        cairo_move_to(cr, TEXT_MARGIN_PX, i * state.fontHeight);
+        renderDuplicateBlocks(cr, (adjValue * LINE_LENGTH) + i * LINE_LENGTH, i * (int) state.fontHeight - yOffset, 3, 1);
+        renderSelection(cr, styleContext, (adjValue * LINE_LENGTH) + i * LINE_LENGTH, i * (int) state.fontHeight - yOffset, 3, 1);
+        renderSignatureMarkers(cr, (adjValue * LINE_LENGTH) + i * LINE_LENGTH, i * (int) state.fontHeight - yOffset, 3, 1);
+
+        cairo_move_to(cr, TEXT_MARGIN_PX, i * (int) state.fontHeight - yOffset);
         pango_cairo_show_layout(cr, pangoLayout);
     }
 
@@ -532,6 +4957,8 @@ gboolean renderAsciiBox(GtkWidget *widget, cairo_t *cr) {
         return FALSE;
     }
 
+    ensureFontMetrics();
+
     GtkStyleContext *styleContext = gtk_widget_get_style_context(widget);
     GtkStateFlags widgetState = gtk_style_context_get_state(styleContext);
 
@@ -550,13 +4977,24 @@ gboolean renderAsciiBox(GtkWidget *widget, cairo_t *cr) {
     gdk_cairo_set_source_rgba(cr, &fgColor);
     pango_layout_set_font_description(pangoLayout, state.fontDesc);
 
-    uint adjValue = gtk_adjustment_get_value(state.scrollAdj);
-    uint linesToDraw = MIN(state.numLines, state.fileNumLines - adjValue);
+    if(!state.byteColorsValid) {
+        buildByteColors(widget);
+    }
+
+    double scrollValue = gtk_adjustment_get_value(state.scrollAdj);
+    uint adjValue = scrollValue;
+    int yOffset = round((scrollValue - adjValue) * state.fontHeight); // Sub-line part of a smooth scroll
+    uint linesToDraw = MIN(state.numLines + 1, state.fileNumLines - adjValue);
     for(int i = 0; i < linesToDraw; i++) {
         fillAsciiBuffer((adjValue * LINE_LENGTH) + i * LINE_LENGTH);
         pango_layout_set_text(pangoLayout, state.asciiLineBuffer, -1);
+        applyByteColors(pangoLayout, (adjValue * LINE_LENGTH) + i * LINE_LENGTH, 1, 1);
 
-        cairo_move_to(cr, TEXT_MARGIN_PX, i * state.fontHeight);
+        renderDuplicateBlocks(cr, (adjValue * LINE_LENGTH) + i * LINE_LENGTH, i * (int) state.fontHeight - yOffset, 1, 0);
+        renderSelection(cr, styleContext, (adjValue * LINE_LENGTH) + i * LINE_LENGTH, i * (int) state.fontHeight - yOffset, 1, 0);
+        renderSignatureMarkers(cr, (adjValue * LINE_LENGTH) + i * LINE_LENGTH, i * (int) state.fontHeight - yOffset, 1, 0);
+
+        cairo_move_to(cr, TEXT_MARGIN_PX, i * (int) state.fontHeight - yOffset);
         pango_cairo_show_layout(cr, pangoLayout);
     }
 
@@ -577,6 +5015,18 @@ void toggleMenuSensitivity() {
 
     gtk_widget_set_sensitive(state.closeMenuI, sensitivity);
     gtk_widget_set_sensitive(state.gotoMenuI,  sensitivity);
+    gtk_widget_set_sensitive(state.exportMenuI, sensitivity);
+    gtk_widget_set_sensitive(state.copyHexMenuI,   sensitivity);
+    gtk_widget_set_sensitive(state.copyRawMenuI,   sensitivity);
+    gtk_widget_set_sensitive(state.selectAllMenuI, sensitivity);
+    gtk_widget_set_sensitive(state.stringsMenuI,   sensitivity);
+    gtk_widget_set_sensitive(state.signaturesMenuI, sensitivity);
+    gtk_widget_set_sensitive(state.nextSignatureMenuI, sensitivity);
+    gtk_widget_set_sensitive(state.previousSignatureMenuI, sensitivity);
+    gtk_widget_set_sensitive(state.duplicatesMenuI, sensitivity);
+    gtk_widget_set_sensitive(state.showDuplicatesMenuI, sensitivity);
+    gtk_widget_set_sensitive(state.nextDuplicateMenuI, sensitivity);
+    gtk_widget_set_sensitive(state.previousDuplicateMenuI, sensitivity);
 }
 
 bool accelCallback(GtkAccelGroup *group, GObject *obj, guint keyval, GdkModifierType modifier, gpointer data) {
@@ -590,10 +5040,26 @@ GtkWidget *buildMenu() {
     GClosure *openClosure = NULL;
     GClosure *closeClosure = NULL;
     GClosure *gotoClosure = NULL;
+    GClosure *exportClosure = NULL;
     GClosure *quitClosure = NULL;
+    GClosure *copyHexClosure = NULL;
+    GClosure *copyRawClosure = NULL;
+    GClosure *selectAllClosure = NULL;
+    GClosure *stringsClosure = NULL;
+    GClosure *signaturesClosure = NULL;
+    GClosure *nextSignatureClosure = NULL;
+    GClosure *previousSignatureClosure = NULL;
+    GClosure *duplicatesClosure = NULL;
+    GClosure *showDuplicatesClosure = NULL;
+    GClosure *nextDuplicateClosure = NULL;
+    GClosure *previousDuplicateClosure = NULL;
 
     GtkWidget *fileMenu =    NULL;
     GtkWidget *fileMenuI =   NULL;
+    GtkWidget *editMenu =    NULL;
+    GtkWidget *editMenuI =   NULL;
+    GtkWidget *toolsMenu =   NULL;
+    GtkWidget *toolsMenuI =  NULL;
 
     GtkWidget *openMenuI =   NULL;
     GtkWidget *fontMenuI =   NULL;
@@ -602,54 +5068,169 @@ GtkWidget *buildMenu() {
     menubar =     gtk_menu_bar_new();
     fileMenu =    gtk_menu_new();
     fileMenuI =   gtk_menu_item_new_with_label("File");
+    editMenu =    gtk_menu_new();
+    editMenuI =   gtk_menu_item_new_with_label("Edit");
+    toolsMenu =   gtk_menu_new();
+    toolsMenuI =  gtk_menu_item_new_with_label("Tools");
 
     openMenuI =        gtk_menu_item_new_with_label("Open");
+    state.recentMenuI = gtk_menu_item_new_with_label("Open Recent");
+    state.recentMenu = gtk_menu_new();
     state.closeMenuI = gtk_menu_item_new_with_label("Close");
     state.gotoMenuI =  gtk_menu_item_new_with_label("Goto");
+    state.exportMenuI = gtk_menu_item_new_with_label("Export Range");
     fontMenuI =        gtk_menu_item_new_with_label("Font");
     quitMenuI =        gtk_menu_item_new_with_label("Quit");
 
+    state.copyHexMenuI =   gtk_menu_item_new_with_label("Copy as Hex");
+    state.copyRawMenuI =   gtk_menu_item_new_with_label("Copy Raw");
+    state.selectAllMenuI = gtk_menu_item_new_with_label("Select All");
+
+    state.stringsMenuI = gtk_menu_item_new_with_label("Strings");
+    state.signaturesMenuI = gtk_menu_item_new_with_label("Scan Signatures");
+    state.nextSignatureMenuI = gtk_menu_item_new_with_label("Next Signature");
+    state.previousSignatureMenuI = gtk_menu_item_new_with_label("Previous Signature");
+    state.duplicatesMenuI = gtk_menu_item_new_with_label("Find Duplicate Blocks");
+    state.showDuplicatesMenuI = gtk_menu_item_new_with_label("Show Copies of Block");
+    state.nextDuplicateMenuI = gtk_menu_item_new_with_label("Next Copy");
+    state.previousDuplicateMenuI = gtk_menu_item_new_with_label("Previous Copy");
+
     g_signal_connect(G_OBJECT(openMenuI),        "activate", G_CALLBACK(openMenuAction),     NULL);
     g_signal_connect(G_OBJECT(state.closeMenuI), "activate", G_CALLBACK(closeCurrentFile),   NULL);
     g_signal_connect(G_OBJECT(state.gotoMenuI),  "activate", G_CALLBACK(gotoMenuAction),     NULL);
+    g_signal_connect(G_OBJECT(state.exportMenuI), "activate", G_CALLBACK(exportMenuAction),  NULL);
     g_signal_connect(G_OBJECT(fontMenuI),        "activate", G_CALLBACK(fontMenuAction),     NULL);
     g_signal_connect(G_OBJECT(quitMenuI),        "activate", G_CALLBACK(shutdownAndCleanup), NULL);
 
+    g_signal_connect(G_OBJECT(state.copyHexMenuI),   "activate", G_CALLBACK(copyHexMenuAction),   NULL);
+    g_signal_connect(G_OBJECT(state.copyRawMenuI),   "activate", G_CALLBACK(copyRawMenuAction),   NULL);
+    g_signal_connect(G_OBJECT(state.selectAllMenuI), "activate", G_CALLBACK(selectAllMenuAction), NULL);
+
+    g_signal_connect(G_OBJECT(state.stringsMenuI), "activate", G_CALLBACK(stringsMenuAction), NULL);
+    g_signal_connect(G_OBJECT(state.signaturesMenuI), "activate", G_CALLBACK(signaturesMenuAction), NULL);
+    g_signal_connect(G_OBJECT(state.nextSignatureMenuI), "activate", G_CALLBACK(nextSignatureMenuAction), NULL);
+    g_signal_connect(G_OBJECT(state.previousSignatureMenuI), "activate", G_CALLBACK(previousSignatureMenuAction), NULL);
+    g_signal_connect(G_OBJECT(state.duplicatesMenuI), "activate", G_CALLBACK(duplicatesMenuAction), NULL);
+    g_signal_connect(G_OBJECT(state.showDuplicatesMenuI), "activate", G_CALLBACK(showDuplicatesMenuAction), NULL);
+    g_signal_connect(G_OBJECT(state.nextDuplicateMenuI), "activate", G_CALLBACK(nextDuplicateMenuAction), NULL);
+    g_signal_connect(G_OBJECT(state.previousDuplicateMenuI), "activate", G_CALLBACK(previousDuplicateMenuAction), NULL);
+
     gtk_accel_map_add_entry("<JAFHE>/File/Open",  GDK_KEY_O, GDK_CONTROL_MASK);
     gtk_accel_map_add_entry("<JAFHE>/File/Close", GDK_KEY_W, GDK_CONTROL_MASK);
     gtk_accel_map_add_entry("<JAFHE>/File/Goto",  GDK_KEY_G, GDK_CONTROL_MASK);
+    gtk_accel_map_add_entry("<JAFHE>/File/Export", GDK_KEY_E, GDK_CONTROL_MASK);
     gtk_accel_map_add_entry("<JAFHE>/File/Quit",  GDK_KEY_Q, GDK_CONTROL_MASK);
 
+    gtk_accel_map_add_entry("<JAFHE>/Edit/CopyHex",   GDK_KEY_C, GDK_CONTROL_MASK);
+    gtk_accel_map_add_entry("<JAFHE>/Edit/CopyRaw",   GDK_KEY_C, GDK_CONTROL_MASK | GDK_SHIFT_MASK);
+    gtk_accel_map_add_entry("<JAFHE>/Edit/SelectAll", GDK_KEY_A, GDK_CONTROL_MASK);
+
+    gtk_accel_map_add_entry("<JAFHE>/Tools/Strings", GDK_KEY_S, GDK_CONTROL_MASK | GDK_SHIFT_MASK);
+    gtk_accel_map_add_entry("<JAFHE>/Tools/Signatures", GDK_KEY_M, GDK_CONTROL_MASK | GDK_SHIFT_MASK);
+    gtk_accel_map_add_entry("<JAFHE>/Tools/NextSignature", GDK_KEY_F3, 0);
+    gtk_accel_map_add_entry("<JAFHE>/Tools/PreviousSignature", GDK_KEY_F3, GDK_SHIFT_MASK);
+    gtk_accel_map_add_entry("<JAFHE>/Tools/Duplicates", GDK_KEY_D, GDK_CONTROL_MASK | GDK_SHIFT_MASK);
+    gtk_accel_map_add_entry("<JAFHE>/Tools/ShowDuplicates", GDK_KEY_D, GDK_CONTROL_MASK);
+    gtk_accel_map_add_entry("<JAFHE>/Tools/NextDuplicate", GDK_KEY_F4, 0);
+    gtk_accel_map_add_entry("<JAFHE>/Tools/PreviousDuplicate", GDK_KEY_F4, GDK_SHIFT_MASK);
+
     accelGroup = gtk_accel_group_new();
 
     openClosure =  g_cclosure_new(G_CALLBACK(accelCallback), openMenuI,        0);
     closeClosure = g_cclosure_new(G_CALLBACK(accelCallback), state.closeMenuI, 0);
     gotoClosure =  g_cclosure_new(G_CALLBACK(accelCallback), state.gotoMenuI,  0);
+    exportClosure = g_cclosure_new(G_CALLBACK(accelCallback), state.exportMenuI, 0);
     quitClosure =  g_cclosure_new(G_CALLBACK(accelCallback), quitMenuI,        0);
 
+    copyHexClosure =   g_cclosure_new(G_CALLBACK(accelCallback), state.copyHexMenuI,   0);
+    copyRawClosure =   g_cclosure_new(G_CALLBACK(accelCallback), state.copyRawMenuI,   0);
+    selectAllClosure = g_cclosure_new(G_CALLBACK(accelCallback), state.selectAllMenuI, 0);
+
+    stringsClosure = g_cclosure_new(G_CALLBACK(accelCallback), state.stringsMenuI, 0);
+    signaturesClosure = g_cclosure_new(G_CALLBACK(accelCallback), state.signaturesMenuI, 0);
+    nextSignatureClosure = g_cclosure_new(G_CALLBACK(accelCallback), state.nextSignatureMenuI, 0);
+    previousSignatureClosure = g_cclosure_new(G_CALLBACK(accelCallback), state.previousSignatureMenuI, 0);
+    duplicatesClosure = g_cclosure_new(G_CALLBACK(accelCallback), state.duplicatesMenuI, 0);
+    showDuplicatesClosure = g_cclosure_new(G_CALLBACK(accelCallback), state.showDuplicatesMenuI, 0);
+    nextDuplicateClosure = g_cclosure_new(G_CALLBACK(accelCallback), state.nextDuplicateMenuI, 0);
+    previousDuplicateClosure = g_cclosure_new(G_CALLBACK(accelCallback), state.previousDuplicateMenuI, 0);
+
     gtk_accel_group_connect_by_path(accelGroup, "<JAFHE>/File/Open",  openClosure);
     gtk_accel_group_connect_by_path(accelGroup, "<JAFHE>/File/Close", closeClosure);
     gtk_accel_group_connect_by_path(accelGroup, "<JAFHE>/File/Goto",  gotoClosure);
+    gtk_accel_group_connect_by_path(accelGroup, "<JAFHE>/File/Export", exportClosure);
     gtk_accel_group_connect_by_path(accelGroup, "<JAFHE>/File/Quit",  quitClosure);
 
+    gtk_accel_group_connect_by_path(accelGroup, "<JAFHE>/Edit/CopyHex",   copyHexClosure);
+    gtk_accel_group_connect_by_path(accelGroup, "<JAFHE>/Edit/CopyRaw",   copyRawClosure);
+    gtk_accel_group_connect_by_path(accelGroup, "<JAFHE>/Edit/SelectAll", selectAllClosure);
+
+    gtk_accel_group_connect_by_path(accelGroup, "<JAFHE>/Tools/Strings", stringsClosure);
+    gtk_accel_group_connect_by_path(accelGroup, "<JAFHE>/Tools/Signatures", signaturesClosure);
+    gtk_accel_group_connect_by_path(accelGroup, "<JAFHE>/Tools/NextSignature", nextSignatureClosure);
+    gtk_accel_group_connect_by_path(accelGroup, "<JAFHE>/Tools/PreviousSignature", previousSignatureClosure);
+    gtk_accel_group_connect_by_path(accelGroup, "<JAFHE>/Tools/Duplicates", duplicatesClosure);
+    gtk_accel_group_connect_by_path(accelGroup, "<JAFHE>/Tools/ShowDuplicates", showDuplicatesClosure);
+    gtk_accel_group_connect_by_path(accelGroup, "<JAFHE>/Tools/NextDuplicate", nextDuplicateClosure);
+    gtk_accel_group_connect_by_path(accelGroup, "<JAFHE>/Tools/PreviousDuplicate", previousDuplicateClosure);
+
     gtk_window_add_accel_group(GTK_WINDOW(state.window), accelGroup);
     gtk_menu_set_accel_group(GTK_MENU(fileMenu), accelGroup);
+    gtk_menu_set_accel_group(GTK_MENU(editMenu), accelGroup);
+    gtk_menu_set_accel_group(GTK_MENU(toolsMenu), accelGroup);
 
     gtk_menu_item_set_accel_path(GTK_MENU_ITEM(openMenuI),        "<JAFHE>/File/Open");
     gtk_menu_item_set_accel_path(GTK_MENU_ITEM(state.closeMenuI), "<JAFHE>/File/Close");
     gtk_menu_item_set_accel_path(GTK_MENU_ITEM(state.gotoMenuI),  "<JAFHE>/File/Goto");
+    gtk_menu_item_set_accel_path(GTK_MENU_ITEM(state.exportMenuI), "<JAFHE>/File/Export");
     gtk_menu_item_set_accel_path(GTK_MENU_ITEM(quitMenuI),        "<JAFHE>/File/Quit");
 
+    gtk_menu_item_set_accel_path(GTK_MENU_ITEM(state.copyHexMenuI),   "<JAFHE>/Edit/CopyHex");
+    gtk_menu_item_set_accel_path(GTK_MENU_ITEM(state.copyRawMenuI),   "<JAFHE>/Edit/CopyRaw");
+    gtk_menu_item_set_accel_path(GTK_MENU_ITEM(state.selectAllMenuI), "<JAFHE>/Edit/SelectAll");
+
+    gtk_menu_item_set_accel_path(GTK_MENU_ITEM(state.stringsMenuI), "<JAFHE>/Tools/Strings");
+    gtk_menu_item_set_accel_path(GTK_MENU_ITEM(state.signaturesMenuI), "<JAFHE>/Tools/Signatures");
+    gtk_menu_item_set_accel_path(GTK_MENU_ITEM(state.nextSignatureMenuI), "<JAFHE>/Tools/NextSignature");
+    gtk_menu_item_set_accel_path(GTK_MENU_ITEM(state.previousSignatureMenuI), "<JAFHE>/Tools/PreviousSignature");
+    gtk_menu_item_set_accel_path(GTK_MENU_ITEM(state.duplicatesMenuI), "<JAFHE>/Tools/Duplicates");
+    gtk_menu_item_set_accel_path(GTK_MENU_ITEM(state.showDuplicatesMenuI), "<JAFHE>/Tools/ShowDuplicates");
+    gtk_menu_item_set_accel_path(GTK_MENU_ITEM(state.nextDuplicateMenuI), "<JAFHE>/Tools/NextDuplicate");
+    gtk_menu_item_set_accel_path(GTK_MENU_ITEM(state.previousDuplicateMenuI), "<JAFHE>/Tools/PreviousDuplicate");
+
     gtk_menu_shell_append(GTK_MENU_SHELL(menubar), fileMenuI);
     gtk_menu_item_set_submenu(GTK_MENU_ITEM(fileMenuI), fileMenu);
     
     gtk_menu_shell_append(GTK_MENU_SHELL(fileMenu), openMenuI);
+    gtk_menu_shell_append(GTK_MENU_SHELL(fileMenu), state.recentMenuI);
+    gtk_menu_item_set_submenu(GTK_MENU_ITEM(state.recentMenuI), state.recentMenu);
     gtk_menu_shell_append(GTK_MENU_SHELL(fileMenu), state.closeMenuI);
     gtk_menu_shell_append(GTK_MENU_SHELL(fileMenu), state.gotoMenuI);
+    gtk_menu_shell_append(GTK_MENU_SHELL(fileMenu), state.exportMenuI);
     gtk_menu_shell_append(GTK_MENU_SHELL(fileMenu), fontMenuI);
     gtk_menu_shell_append(GTK_MENU_SHELL(fileMenu), quitMenuI);
 
+    gtk_menu_shell_append(GTK_MENU_SHELL(menubar), editMenuI);
+    gtk_menu_item_set_submenu(GTK_MENU_ITEM(editMenuI), editMenu);
+
+    gtk_menu_shell_append(GTK_MENU_SHELL(editMenu), state.copyHexMenuI);
+    gtk_menu_shell_append(GTK_MENU_SHELL(editMenu), state.copyRawMenuI);
+    gtk_menu_shell_append(GTK_MENU_SHELL(editMenu), state.selectAllMenuI);
+
+    gtk_menu_shell_append(GTK_MENU_SHELL(menubar), toolsMenuI);
+    gtk_menu_item_set_submenu(GTK_MENU_ITEM(toolsMenuI), toolsMenu);
+
+    gtk_menu_shell_append(GTK_MENU_SHELL(toolsMenu), state.stringsMenuI);
+    gtk_menu_shell_append(GTK_MENU_SHELL(toolsMenu), state.signaturesMenuI);
+    gtk_menu_shell_append(GTK_MENU_SHELL(toolsMenu), state.nextSignatureMenuI);
+    gtk_menu_shell_append(GTK_MENU_SHELL(toolsMenu), state.previousSignatureMenuI);
+    gtk_menu_shell_append(GTK_MENU_SHELL(toolsMenu), state.duplicatesMenuI);
+    gtk_menu_shell_append(GTK_MENU_SHELL(toolsMenu), state.showDuplicatesMenuI);
+    gtk_menu_shell_append(GTK_MENU_SHELL(toolsMenu), state.nextDuplicateMenuI);
+    gtk_menu_shell_append(GTK_MENU_SHELL(toolsMenu), state.previousDuplicateMenuI);
+
     toggleMenuSensitivity();
+    rebuildRecentMenu();
 
     return menubar;
 }
@@ -663,9 +5244,24 @@ int main(int argc, char **argv) {
     GtkStyleContext *asciiStyleContext = NULL;
 
     PangoFontDescription *defaultFontDesc = NULL;
+    char *sessionFont = NULL;
+    char *startupFile = NULL;
+
+    state.startupTime = g_get_monotonic_time();
 
     gtk_init(&argc, &argv);
 
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--startup-benchmark") == 0) {
+            state.startupBenchmark = TRUE;
+        }
+        else {
+            startupFile = argv[i];
+        }
+    }
+
+    loadSession();
+
     state.window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
     gtk_window_set_title(GTK_WINDOW(state.window), "JAFHE");
     gtk_window_set_default_size(GTK_WINDOW(state.window), 600, 400);
@@ -674,8 +5270,10 @@ int main(int argc, char **argv) {
     g_signal_connect(G_OBJECT(state.window), "destroy", G_CALLBACK(shutdownAndCleanup), NULL);
     g_signal_connect(G_OBJECT(state.window), "key-press-event", G_CALLBACK(onKeyPress), NULL);
 
-    defaultFontDesc = pango_font_description_from_string(DEFAULT_FONT);
+    sessionFont = g_key_file_get_string(state.session, "Session", "font", NULL);
+    defaultFontDesc = pango_font_description_from_string(sessionFont ? sessionFont : DEFAULT_FONT);
     updateFont(defaultFontDesc);
+    g_free(sessionFont);
 
     vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
     gtk_container_add(GTK_CONTAINER(state.window), vbox);
@@ -691,17 +5289,29 @@ int main(int argc, char **argv) {
     state.hexBox = gtk_drawing_area_new();
     hexStyleContext = gtk_widget_get_style_context(state.hexBox);
     gtk_style_context_add_class(hexStyleContext, GTK_STYLE_CLASS_VIEW);
-    gtk_widget_set_events(state.hexBox, GDK_SCROLL_MASK);
+    gtk_widget_set_events(state.hexBox, GDK_SCROLL_MASK | GDK_SMOOTH_SCROLL_MASK | GDK_BUTTON_PRESS_MASK | GDK_BUTTON_RELEASE_MASK | GDK_BUTTON_MOTION_MASK);
     g_signal_connect(state.hexBox, "size-allocate", G_CALLBACK(onUpdateSize), NULL);
+    g_signal_connect(state.hexBox, "realize", G_CALLBACK(onViewRealize), NULL);
     g_signal_connect(state.hexBox, "draw", G_CALLBACK(renderHexBox), NULL);
+    g_signal_connect(state.hexBox, "style-updated", G_CALLBACK(onStyleUpdated), NULL);
     g_signal_connect(state.hexBox, "scroll-event", G_CALLBACK(onScrollEvent), NULL);
+    g_signal_connect(state.hexBox, "button-press-event", G_CALLBACK(onButtonPress), NULL);
+    g_signal_connect(state.hexBox, "motion-notify-event", G_CALLBACK(onMotion), NULL);
+    g_signal_connect(state.hexBox, "button-release-event", G_CALLBACK(onButtonRelease), NULL);
+    gtk_widget_set_has_tooltip(state.hexBox, TRUE);
+    g_signal_connect(state.hexBox, "query-tooltip", G_CALLBACK(onQuerySignatureTooltip), NULL);
 
     state.asciiBox = gtk_drawing_area_new();
     asciiStyleContext = gtk_widget_get_style_context(state.asciiBox);
     gtk_style_context_add_class(asciiStyleContext, GTK_STYLE_CLASS_VIEW);
-    gtk_widget_set_events(state.asciiBox, GDK_SCROLL_MASK);
+    gtk_widget_set_events(state.asciiBox, GDK_SCROLL_MASK | GDK_SMOOTH_SCROLL_MASK | GDK_BUTTON_PRESS_MASK | GDK_BUTTON_RELEASE_MASK | GDK_BUTTON_MOTION_MASK);
     g_signal_connect(state.asciiBox, "draw", G_CALLBACK(renderAsciiBox), NULL);
     g_signal_connect(state.asciiBox, "scroll-event", G_CALLBACK(onScrollEvent), NULL);
+    g_signal_connect(state.asciiBox, "button-press-event", G_CALLBACK(onButtonPress), NULL);
+    g_signal_connect(state.asciiBox, "motion-notify-event", G_CALLBACK(onMotion), NULL);
+    g_signal_connect(state.asciiBox, "button-release-event", G_CALLBACK(onButtonRelease), NULL);
+    gtk_widget_set_has_tooltip(state.asciiBox, TRUE);
+    g_signal_connect(state.asciiBox, "query-tooltip", G_CALLBACK(onQuerySignatureTooltip), NULL);
 
     state.scrollAdj = gtk_adjustment_new(0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
     g_signal_connect(state.scrollAdj, "value-changed", G_CALLBACK(onAdjValueChanged), NULL);
@@ -717,7 +5327,23 @@ int main(int argc, char **argv) {
     gtk_box_pack_start(GTK_BOX(vbox), menubar, FALSE, FALSE, 0);
     gtk_box_pack_start(GTK_BOX(vbox), state.viewWidgetsBox, TRUE, TRUE, 0);
 
+    // Opened before the window is shown so the first frame already has the file in it
+    if(startupFile) {
+        openFile(startupFile);
+    }
+    else {
+        char **files = g_key_file_get_string_list(state.session, "Session", "files", NULL, NULL);
+
+        if(files && files[0] && g_file_test(files[0], G_FILE_TEST_IS_REGULAR)) {
+            openFile(files[0]);
+        }
+
+        g_strfreev(files);
+    }
+    updateTitle();
+
     gtk_widget_show_all(state.window);
+    g_signal_connect(gtk_widget_get_frame_clock(state.window), "after-paint", G_CALLBACK(onFirstFrame), NULL);
 
     gtk_main();
 
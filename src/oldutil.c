@@ -5,53 +5,6 @@
 typedef unsigned int uint;
 typedef uint8_t byte;
 
-struct _Color {
-    union {
-        uint RGBA;
-        struct {
-            byte alpha;
-            byte blue;
-            byte green;
-            byte red;
-        };
-    };
-};
-typedef struct _Color Color;
-
-double adjustRange(double value, double oldmin, double oldmax, double newmin, double newmax) {
-    return ((value - oldmin) / (oldmax - oldmin)) * (newmax - newmin) + newmin;
-}
-
-double normalizeColor(double color) {
-    return adjustRange(color, 0, 255, 0, 1);
-}
-
-double denormalizeColor(double color) {
-    return adjustRange(color, 0, 1, 0, 255);
-}
-
-Color gdkToColor(GdkRGBA gdkColor) {
-    Color result = {0};
-
-    result.red =   (byte) denormalizeColor(gdkColor.red);
-    result.green = (byte) denormalizeColor(gdkColor.green);
-    result.blue =  (byte) denormalizeColor(gdkColor.blue);
-    result.alpha = (byte) denormalizeColor(gdkColor.alpha);
-
-    return result;
-} 
-
-GdkRGBA colorToGdk(Color color) {
-    GdkRGBA result = {0};
-
-    result.red =   (byte) normalizeColor(color.red);
-    result.green = (byte) normalizeColor(color.green);
-    result.blue =  (byte) normalizeColor(color.blue);
-    result.alpha = (byte) normalizeColor(color.alpha);
-
-    return result;
-}
-
 void dumpState(GtkStateFlags flags) {
     printf("GTK_STATE_FLAG_NORMAL:        %s\n",  (flags  &  GTK_STATE_FLAG_NORMAL        ?  "true"  :  "false"));
     printf("GTK_STATE_FLAG_ACTIVE:        %s\n",  (flags  &  GTK_STATE_FLAG_ACTIVE        ?  "true"  :  "false"));